@@ -1,24 +1,34 @@
 #pragma once
 
-#include "htc/lenia_graph.hpp"
+#include "htc/simulation_backend.hpp"
+#include "htc/snapshot_writer.hpp"
+#include "htc/frame_recorder.hpp"
 
 #include "lve/device.hpp"
 #include "lve/utils.hpp"
 
 #include <vulkan/vulkan.h>
 #include <hip/hip_runtime.h>
-#include <optional>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+
+
+// Number of frames between two checks of the parameter file
+#define PARAMETERS_CHECK_INTERVAL 30
 
 
 namespace htc {
 
 	// This class is responsible for managing all operations related to image processing
 	// using a HIP-accelerated graph of operations and outputting the results to a Vulkan buffer
+	// NOTE: The output buffers hold the frames of the display view, their size doesn't depend on the size of the world
 	class HipTracer {
 
 		public:
 
-			HipTracer(int width, int height, uint32_t outputBuffersCount, lve::LveDevice& lveDevice);
+			HipTracer(const SimulationConfig& config, const DisplayView& view, uint32_t outputBuffersCount, lve::LveDevice& lveDevice);
 			~HipTracer();
 
 			// Not copyable or movable
@@ -28,24 +38,58 @@ namespace htc {
 			std::vector<VkBuffer> bind();
 			void getNextFrame(uint32_t outputBufferIndex);
 
+			// Move or zoom the view from another thread, the next frame shows it
+			// NOTE: The size of the frames is fixed, the width and height of the view are ignored
+			void setDisplayView(const DisplayView& view);
+
 		private:
 
 			void createOutputFrameBuffers();
+			void reloadParametersIfChanged();
+			void recordFrame(uint32_t outputBufferIndex);
+			void countStep();
 
+			// Size of the frames, the one of the display view
 			int width;
 			int height;
 
+			// View requested by the render thread, applied between two frames
+			std::mutex viewMutex;
+			DisplayView pendingView;
+			bool viewChanged = false;
+
 			uint32_t outputBuffersCount;
 
 			lve::LveDevice& lveDevice;
 
-			std::vector<lve::Vertex*> outputFrameBuffers;
+			std::vector<lve::Pixel*> outputFrameBuffers;
 
 			std::vector<void*> hipExternalMemoryHandles;
 
 			std::vector<VkBuffer> interoperabilityBuffers;
 			std::vector<VkDeviceMemory> interoperabilityMemories;
 
-			std::optional<LeniaGraph> leniaGraph;
+			std::unique_ptr<SimulationBackend> simulation;
+
+			// Host staging buffer used when the simulation runs on the CPU
+			lve::Pixel* hostFrameBuffer = nullptr;
+
+			// Only the last step of a frame is colored and handed to the viewer
+			int stepsPerFrame;
+
+			// The parameter file is reloaded when it changes, to tune the running simulation
+			std::string parametersPath;
+			std::filesystem::file_time_type parametersWriteTime;
+			uint32_t framesSinceParametersCheck = 0;
+
+			// Snapshots are taken every snapshotInterval steps and written in the background
+			std::unique_ptr<SnapshotWriter> snapshots;
+			int snapshotInterval;
+			uint64_t stepCount = 0;
+
+			// The frames are quantized where they are produced, only 3 bytes per cell reach the recorder
+			std::unique_ptr<FrameRecorder> recorder;
+			uint8_t* d_recordFrame = nullptr;
+			uint8_t* h_recordFrame = nullptr;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "htc/simulation_backend.hpp"
+
+#include <functional>
+#include <map>
+#include <string>
+
+
+// Runs of a candidate before and while it is timed, the median of the timed runs is kept
+#define TUNING_WARMUP_RUNS 2
+#define TUNING_TIMED_RUNS 5
+
+// Name of the database in the user cache directory ($XDG_CACHE_HOME or ~/.cache)
+#define TUNING_DATABASE_NAME "leniamd/tuning.db"
+
+
+namespace htc {
+
+	// This class stores the winners of the autotuner, one "key = value" line per tuned shape
+	// the file is loaded when the database is opened and rewritten as a whole by each store
+	// NOTE: The file is replaced atomically, but two runs tuning at the same time keep only the entries of the last one
+	// NOTE: An empty path gives a database that is never read nor written
+	class TuningDatabase {
+
+		public:
+
+			explicit TuningDatabase(const std::string& path);
+
+			bool find(const std::string& key, std::string& value) const;
+
+			// Errors are reported but not thrown, the run goes on with the winner
+			void store(const std::string& key, const std::string& value);
+
+			const std::string& path() const { return databasePath; }
+
+		private:
+
+			std::string databasePath;
+			std::map<std::string, std::string> entries;
+
+			void load();
+			void save() const;
+	};
+
+	// Database selected by the config, empty if the tuning mode is Off or no cache directory is known
+	std::string tuningDatabasePath(const SimulationConfig& config);
+
+	// Identify a tuned shape: scope names the backend (and the device), the rest comes from the config
+	// NOTE: threadCount is the resolved size of the thread pool, 0 for the GPU backends
+	std::string tuningKey(const std::string& scope, const SimulationConfig& config, int threadCount);
+
+	// Median time of one run in seconds, after the warm-up runs
+	double timeCandidate(const std::function<void()>& run, int warmupRuns = TUNING_WARMUP_RUNS, int timedRuns = TUNING_TIMED_RUNS);
+
+	// Resolve ConvolutionMode::Auto for a backend, from the database or by timing each mode with timeMode
+	// timeMode builds the convolution of the given mode and times it, it throws std::invalid_argument
+	// for a mode that the backend does not support with this config, which is skipped
+	// NOTE: Any other mode is returned as is, nothing is timed
+	ConvolutionMode resolveConvolutionMode(const SimulationConfig& config, const std::string& scope, int threadCount,
+											const std::function<double(ConvolutionMode)>& timeMode);
+}
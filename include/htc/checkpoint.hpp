@@ -0,0 +1,104 @@
+#pragma once
+
+#include "htc/simulation_backend.hpp"
+#include "htc/parameters.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+// Version written in new checkpoints, files with another version are rejected
+#define CHECKPOINT_VERSION 1
+
+// The state planes start on a page boundary, so that they can be used in place from the mapping
+#define CHECKPOINT_ALIGNMENT 4096
+
+
+namespace htc {
+
+	// Fixed header at the start of a checkpoint file, followed by:
+	// - ringCount CheckpointRing
+	// - batch GrowthParameters, one per world
+	// - padding up to dataOffset
+	// - the fp32 state, [world][channel][height][width]
+	// NOTE: All the values are stored in the byte order of the machine that wrote the file (little-endian on x86)
+	struct CheckpointHeader {
+		char magic[8];				// "LENIACKP"
+		uint32_t version;
+		uint32_t headerSize;		// sizeof(CheckpointHeader) when written
+
+		uint32_t width;
+		uint32_t height;
+		uint32_t channels;
+		uint32_t batch;
+		uint32_t kernelRadius;
+		uint32_t ringCount;
+
+		uint64_t step;				// Number of steps simulated when the checkpoint was taken
+		uint64_t dataOffset;		// Offset of the state, a multiple of CHECKPOINT_ALIGNMENT
+		uint64_t dataSize;			// Size of the state in bytes
+
+		GrowthParameters growth;	// Growth parameters of LeniaParameters, each world has its own as well
+
+		uint8_t boundary;			// BoundaryMode of the run
+		uint8_t precision;			// Storage Precision of the run, the state itself is always stored in fp32
+		uint16_t reserved;
+	};
+
+	// Kernel ring with a fixed layout on disk
+	struct CheckpointRing {
+		int32_t source;
+		int32_t target;
+		float mu;
+		float sigma;
+		float weight;
+	};
+
+	// Header, rings and growth parameters of a checkpoint of the simulation, padded up to the start of the state
+	// NOTE: Followed by the state of every world, it makes a complete checkpoint
+	std::vector<char> encodeCheckpointMetadata(const SimulationBackend& simulation, uint64_t step);
+
+	// Write the parameters and the state of every world of the simulation to path
+	// NOTE: The file is written next to path then renamed, an interrupted save never replaces a valid checkpoint
+	void saveCheckpoint(const std::string& path, SimulationBackend& simulation, uint64_t step);
+
+	// This class maps a checkpoint file in memory and validates its header
+	// the state is never copied, worldState points straight into the mapped pages
+	class MappedCheckpoint {
+
+		public:
+
+			explicit MappedCheckpoint(const std::string& path);
+			~MappedCheckpoint();
+
+			// Not copyable or movable
+			MappedCheckpoint(const MappedCheckpoint&) = delete;
+			MappedCheckpoint& operator=(const MappedCheckpoint&) = delete;
+
+			const CheckpointHeader& header() const { return *static_cast<const CheckpointHeader*>(mapping); }
+
+			LeniaParameters parameters() const;
+			const GrowthParameters& worldGrowth(int world) const;
+
+			// [channels][height][width] state of one world, valid as long as the checkpoint is alive
+			const float* worldState(int world) const;
+
+		private:
+
+			std::string path;
+
+			void* mapping = nullptr;
+			size_t mappingSize = 0;
+
+			void validate() const;
+	};
+
+	// The config with the world size, channels, batch, kernel radius, boundary mode and precision of the checkpoint
+	SimulationConfig checkpointConfig(const MappedCheckpoint& checkpoint, const SimulationConfig& config);
+
+	// Load the parameters and the state of a checkpoint into a backend created from checkpointConfig
+	// returns the number of steps stored in the checkpoint
+	uint64_t restoreCheckpoint(const MappedCheckpoint& checkpoint, SimulationBackend& simulation);
+}
@@ -1,17 +1,31 @@
 #pragma once
 
+#include "htc/simulation_backend.hpp"
+#include "htc/separable_kernel.hpp"
+
 #include <hip/hip_runtime.h>
+#include <hipfft/hipfft.h>
 #include <miopen/miopen.h>
+#include <string>
+#include <vector>
 
 
 namespace htc {
 
 	// This class is responsible for managing all the ressources associated with MIOPEN and the convolution
+	// NOTE: In FFT mode, MIOpen is replaced by hipFFT and the precomputed kernel spectra
+	// NOTE: In separable mode, each low-rank component runs as a row pass and a column pass
+	// NOTE: The input and output hold a batch of worlds (NCHW), convolved in the same calls with the same kernels
+	// NOTE: The input and output use the storage type of the precision, the FFT and separable modes accumulate in fp32
+	// NOTE: In direct mode, every MIOpen solution is timed with its workspace and the fastest is kept in the tuning database,
+	// the later runs only compile it and call it through the immediate mode API
 	class ConvolutionManager {
 
 		public:
 
-			ConvolutionManager(int width, int height, int depth, float* input, float* output);
+			// h_kernel is the kernel tensor in host memory, in the MIOpen filter layout
+			// NOTE: The convolution mode must be resolved, ConvolutionMode::Auto is rejected
+			ConvolutionManager(const SimulationConfig& config, int depth, const float* h_kernel, void* input, void* output);
 			~ConvolutionManager();
 
 			// Not copyable or movable
@@ -20,6 +34,9 @@ namespace htc {
 
 			void runConvolution();
 
+			// Replace the kernel tensor, the MIOpen algorithm and the FFT plans stay valid
+			void setKernel(const float* h_kernel);
+
 		private:
 
 			hipStream_t stream;
@@ -31,34 +48,82 @@ namespace htc {
 			miopenTensorDescriptor_t outputDescriptor;
 			miopenTensorDescriptor_t kernelDescriptor;
 
-			// Convolution parameters
-			const float alpha = 1.0f;
-			const float beta = 0.0f;
-
 			int width;
 			int height;
 			int depth;
+			int batch;
+
+			int kernelRadius;
+			int kernelSize;
+
+			ConvolutionMode mode;
+			BoundaryMode boundary;
+			float separableTolerance;
+			Precision precision;
 
 			// NOTE: "depth" is a misnomer, it is actually the number of channels
 			// NOTE: Need to change this to "channels" in the future
 
-			float* input;
-			float* output;
-			float* kernel;
+			void* input;
+			void* output;
+			void* kernel;		// Same storage type as the state, only used by MIOpen
 
 			// Convolution descriptor
 			miopenConvolutionDescriptor_t convolutionDescriptor;
 
-			// Convolution algorithm
-			miopenConvFwdAlgorithm_t convolutionAlgorithm;
+			// Convolution solution, found by the autotuner or read from the tuning database
+			TuningMode tuning;
+			std::string tuningDatabase;
+			std::string solutionKey;
+			uint64_t solutionId = 0;
 			size_t workspaceSize = 0;
 			void* workspace = nullptr;
 
-			void init_kernels();
-			void fill_guassian_kernel(int sourceChannel, int targetChannel, float mu, float sigma, float* h_kernel);
+			// FFT resources
+			hipfftHandle forwardPlan;
+			hipfftHandle inversePlan;
+
+			int fftWidth;
+			int fftHeight;
+			int spectrumSize;
+
+			float* paddedPlanes;		// [batch][depth][fftHeight][fftWidth], zero outside of the world
+			float* outputPlanes;		// [batch][depth][fftHeight][fftWidth]
+			float2* kernelSpectra;		// [target][source][spectrumSize]
+			float2* inputSpectra;		// [batch][source][spectrumSize]
+			float2* outputSpectra;		// [batch][target][spectrumSize]
+
+			// Separable resources
+			struct SeparableComponent {
+				int source;
+				int target;
+				float* horizontal;		// Device filters of kernelSize values
+				float* vertical;
+			};
+
+			std::vector<SeparableComponent> separableComponents;
+			float* separableFilters;	// [component][horizontal, vertical][kernelSize]
+			float* rowPass;				// [batch][height][width]
+			float* separableOutput;		// [batch][depth][height][width], only with a 16-bit state
+
+			void init_kernels(const float* h_kernel);
+			void upload_kernel(const float* h_kernel);
 
 			void set_descriptors();
-			
+
 			void find_algorithm();
+			uint64_t search_solution();
+			bool compile_solution(uint64_t solution);
+			void allocate_workspace(size_t size);
+
+			void init_fft(const float* h_kernel);
+			void upload_kernel_spectra(const float* h_kernel);
+			void run_fft();
+
+			void upload_separable_filters(const float* h_kernel);
+			void run_separable();
 	};
-}
\ No newline at end of file
+
+	// Device and MIOpen version of the tuning keys, so that the shapes are tuned again on another GPU or after an upgrade
+	std::string hipTuningScope();
+}
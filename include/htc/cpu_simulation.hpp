@@ -0,0 +1,99 @@
+#pragma once
+
+#include "htc/simulation_backend.hpp"
+#include "htc/display.hpp"
+#include "htc/host_convolution.hpp"
+#include "htc/thread_pool.hpp"
+#include "htc/parameters.hpp"
+
+#include "lve/pixel.hpp"
+
+#include <memory>
+#include <vector>
+
+
+namespace htc {
+
+	// This class runs the Lenia simulation on the CPU, without any HIP or MIOpen dependency
+	// it mirrors the GPU graph: convolution -> update -> color, each stage split across a thread pool
+	// NOTE: With the fused color pass, the update and the color stages run as a single pass
+	// NOTE: The 16-bit precisions are emulated by rounding the stored values, the state stays in fp32 memory
+	class CpuSimulation : public SimulationBackend {
+
+		public:
+
+			CpuSimulation(const SimulationConfig& config);
+			~CpuSimulation() override = default;
+
+			// Not copyable or movable
+			CpuSimulation(const CpuSimulation&) = delete;
+			CpuSimulation& operator=(const CpuSimulation&) = delete;
+
+			void step(lve::Pixel* output) override;
+
+			void runConvolution() override;
+			void runUpdate() override;
+			void runColor(lve::Pixel* output) override;
+			void runUpdateColor(lve::Pixel* output) override;
+
+			void setDisplayView(const DisplayView& view) override;
+
+			void setParameters(const LeniaParameters& parameters) override;
+			const LeniaParameters& parameters() const override { return leniaParameters; }
+
+			void setWorldGrowth(int world, const GrowthParameters& growth) override;
+			const GrowthParameters& growth(int world) const override;
+			void resetWorld(int world, uint64_t seed) override;
+
+			void readState(float* h_state) override;
+			void readWorldState(int world, float* h_state) override;
+			void writeWorldState(int world, const float* h_state) override;
+			std::vector<WorldMetrics> readMetrics() override;
+
+			int worldWidth() const override { return width; }
+			int worldHeight() const override { return height; }
+			int radius() const override { return kernelRadius; }
+			int channels() const override { return depth; }
+			int batchSize() const override { return batch; }
+			BoundaryMode boundaryMode() const override { return boundary; }
+			Precision storagePrecision() const override { return precision; }
+
+			bool usesDeviceMemory() const override { return false; }
+			const char* name() const override { return "cpu"; }
+
+		private:
+
+			ThreadPool threadPool;
+
+			int width;
+			int height;
+
+			int depth;
+			int batch;
+
+			int kernelRadius;
+
+			BoundaryMode boundary;
+			ColorPass colorPass;
+			Precision precision;
+
+			// Cells drawn by each pixel of the output, the fused pass is only used with one pixel per cell
+			DisplayFootprint footprint;
+
+			LeniaParameters leniaParameters;
+			std::vector<GrowthParameters> worldGrowth;
+
+			// State of the simulation, [world][channel][height][width]
+			std::vector<float> state;
+			std::vector<float> intermediate;
+
+			// Convolution engine selected by the config, or by the autotuner
+			std::unique_ptr<HostConvolution> convolution;
+
+			ConvolutionMode choose_convolution(const SimulationConfig& config, const float* kernel);
+			void init_state(uint64_t seed);
+			void update_worlds(int firstWorld);
+			void color_view(lve::Pixel* output);
+			void check_world(int world) const;
+	};
+}
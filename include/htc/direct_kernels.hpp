@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+
+
+namespace htc {
+
+	// Convolve row y of the target channel, cross-correlating the kernel tensor with an input of depth planes
+	// padded by radius cells ([depth][paddedHeight][paddedWidth]) into width cells of outputRow
+	// NOTE: Every implementation adds the taps in the order (source, ky, kx), so that they round the same way
+	using DirectRowKernel = void (*)(const float* kernel, const float* padded, int paddedWidth, int paddedHeight,
+										int width, int depth, int radius, int target, int y, float* outputRow);
+
+	// Implementation for any shape, the loops over the taps are runtime loops
+	void convolveDirectRow(const float* kernel, const float* padded, int paddedWidth, int paddedHeight,
+							int width, int depth, int radius, int target, int y, float* outputRow);
+
+	// Specialised implementation of the shape if it is in the LENIA_KERNEL_SHAPES list of CMake, the generic one otherwise
+	// NOTE: The other shapes use the generic convolution, which gives the same results
+	DirectRowKernel selectDirectRowKernel(int radius, int channels);
+
+	// True if the shape has a specialised implementation
+	bool isSpecializedKernelShape(int radius, int channels);
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "htc/simulation_backend.hpp"
+
+#include "lve/pixel.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+
+namespace htc {
+
+	// Quantize a color component to 8 bits, the same rounding as quantizeFrameKernel
+	inline uint8_t quantizeColor(float value) {
+		return static_cast<uint8_t>(std::min(std::max(value, 0.0f), 1.0f) * 255.0f + 0.5f);
+	}
+
+	// Host equivalent of the outputs of colorKernel, the missing channels stay black
+	inline void writeCell(lve::Pixel& pixel, float r, float g, float b) {
+		pixel = {quantizeColor(r), quantizeColor(g), quantizeColor(b), 255};
+	}
+
+	// Replace the green (1) or the blue (2) component of a cell written by writeCell
+	inline void writeChannel(lve::Pixel& pixel, int channel, float value) {
+		(channel == 1 ? pixel.g : pixel.b) = quantizeColor(value);
+	}
+
+	// Cells covered by each pixel of a display view: pixel (x, y) covers the columns [columns[2x], columns[2x + 1])
+	// and the rows [rows[2y], rows[2y + 1]), a zoomed-in view covers the same cell with several pixels
+	struct DisplayFootprint {
+		int width;
+		int height;
+		DownsampleFilter filter;
+		std::vector<int> columns;
+		std::vector<int> rows;
+
+		// One pixel per cell over the whole world, the color passes write the cells in place
+		bool direct;
+	};
+
+	// Keep the zoom at 1 or more and the view inside of the world
+	void clampDisplayView(DisplayView& view);
+
+	// Footprint of the view on a world, a view without size takes the size of the world
+	DisplayFootprint computeDisplayFootprint(const DisplayView& view, int worldWidth, int worldHeight);
+
+	// Color the pixel rows [rowBegin, rowEnd) of a view with the box or max filter
+	// row(channel, y, x, count) returns count consecutive cells of a row of the first world
+	// NOTE: Host equivalent of viewColorKernel, each row of cells is read once per pixel row
+	template <typename Row>
+	void colorViewRows(const DisplayFootprint& footprint, int channels, int rowBegin, int rowEnd, lve::Pixel* output, const Row& row) {
+		int colored = std::min(channels, 3);
+		int firstColumn = footprint.columns.front();
+		int columnCount = footprint.columns.back() - firstColumn;
+
+		// Sums or maxima of the pixels of one row, [channel][pixel]
+		std::vector<float> values(3 * footprint.width);
+
+		for (int py = rowBegin; py < rowEnd; py++) {
+			std::fill(values.begin(), values.end(), 0.0f);
+
+			for (int y = footprint.rows[2 * py]; y < footprint.rows[2 * py + 1]; y++) {
+				for (int z = 0; z < colored; z++) {
+					const float* cells = row(z, y, firstColumn, columnCount) - firstColumn;
+					float* channelValues = &values[z * footprint.width];
+
+					for (int px = 0; px < footprint.width; px++) {
+						float value = channelValues[px];
+						for (int x = footprint.columns[2 * px]; x < footprint.columns[2 * px + 1]; x++) {
+							value = footprint.filter == DownsampleFilter::Max ? std::max(value, cells[x]) : value + cells[x];
+						}
+						channelValues[px] = value;
+					}
+				}
+			}
+
+			int cellRows = footprint.rows[2 * py + 1] - footprint.rows[2 * py];
+			for (int px = 0; px < footprint.width; px++) {
+				float scale = 1.0f;
+				if (footprint.filter == DownsampleFilter::Box) {
+					scale = 1.0f / (cellRows * (footprint.columns[2 * px + 1] - footprint.columns[2 * px]));
+				}
+
+				// The missing channels are black
+				writeCell(output[static_cast<size_t>(py) * footprint.width + px],
+					values[0 * footprint.width + px] * scale,
+					values[1 * footprint.width + px] * scale,
+					values[2 * footprint.width + px] * scale);
+			}
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "htc/thread_pool.hpp"
+
+#include <vector>
+
+
+namespace htc {
+
+	// Single precision complex value, binary compatible with float2 / hipfftComplex
+	// NOTE: std::complex is avoided because its multiplication is not inlined without -ffast-math
+	struct Complex {
+		float re;
+		float im;
+	};
+
+	// This class holds the twiddle factors of a 1D complex FFT of a given size
+	// it uses a Stockham autosort algorithm with radix 2, 3, 4 and 5 butterflies
+	// NOTE: Any size works, but sizes with only 2, 3 and 5 as prime factors are much faster
+	class FftPlan {
+
+		public:
+
+			explicit FftPlan(int size);
+
+			// Transforms are done in place and are not normalized
+			// NOTE: scratch must hold size() values
+			void forward(Complex* data, Complex* scratch) const;
+			void inverse(Complex* data, Complex* scratch) const;
+
+			int size() const { return n; }
+
+			// Smallest size >= minimumSize whose prime factors are 2, 3 and 5
+			static int nextFastSize(int minimumSize);
+
+		private:
+
+			struct Stage {
+				int radix;
+				int m;			// Length of the sub-sequences after this stage
+				int stride;		// Product of the radices of the previous stages
+				std::vector<Complex> twiddles;	// [j][u] = exp(-2i * pi * j * u / (radix * m))
+				std::vector<Complex> roots;		// [k] = exp(-2i * pi * k / radix), used by the generic butterfly
+			};
+
+			int n;
+			std::vector<Stage> stages;
+
+			void transform(Complex* data, Complex* scratch, bool inverse) const;
+	};
+
+	// This class computes 2D real to complex transforms with a [height][width / 2 + 1] spectrum layout
+	// (the same layout as hipFFT and FFTW), rows and columns are split across a thread pool
+	class RealFft2d {
+
+		public:
+
+			RealFft2d(int width, int height);
+
+			int width() const { return rowPlan.size(); }
+			int height() const { return columnPlan.size(); }
+			int spectrumWidth() const { return rowPlan.size() / 2 + 1; }
+			int spectrumSize() const { return spectrumWidth() * height(); }
+
+			// Transform an inputWidth x inputHeight plane, zero padded up to the transform size
+			void forward(const float* input, int inputWidth, int inputHeight, Complex* spectrum, ThreadPool& threadPool) const;
+
+			// Transform back and keep the top left outputWidth x outputHeight corner
+			// NOTE: The spectrum is overwritten and the result is not normalized
+			void inverse(Complex* spectrum, float* output, int outputWidth, int outputHeight, ThreadPool& threadPool) const;
+
+		private:
+
+			FftPlan rowPlan;
+			FftPlan columnPlan;
+
+			void transformColumns(Complex* spectrum, bool inverse, ThreadPool& threadPool) const;
+	};
+}
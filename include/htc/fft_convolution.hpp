@@ -0,0 +1,52 @@
+#pragma once
+
+#include "htc/host_convolution.hpp"
+#include "htc/fft.hpp"
+
+#include <vector>
+
+
+namespace htc {
+
+	// This class computes the convolution in the frequency domain
+	// each source channel is transformed once per step, multiplied by the cached kernel spectra
+	// and accumulated per target channel, which then needs a single inverse transform
+	// NOTE: The cost per pixel barely depends on the kernel radius
+	// NOTE: Periodic boundaries use a transform of the size of the world, zero padding uses
+	// NOTE: a transform large enough to hold the world and one radius of padding
+	class FftConvolution : public HostConvolution {
+
+		public:
+
+			FftConvolution(const SimulationConfig& config, int depth, const float* kernel, ThreadPool& threadPool);
+
+			void run(const float* input, float* output) override;
+			void setKernel(const float* kernel) override;
+
+			int transformWidth() const { return fft.width(); }
+			int transformHeight() const { return fft.height(); }
+
+		private:
+
+			ThreadPool& threadPool;
+
+			int width;
+			int height;
+			int depth;
+			int kernelRadius;
+
+			RealFft2d fft;
+
+			// Spectra, each of fft.spectrumSize() values
+			std::vector<Complex> kernelSpectra;		// [target][source], normalized by the transform size
+			std::vector<Complex> inputSpectra;		// [source]
+			std::vector<Complex> outputSpectra;		// [target]
+	};
+
+	// Transform size needed along one axis for a given boundary mode
+	int fftConvolutionSize(int size, int kernelRadius, BoundaryMode boundary);
+
+	// Compute the spectra of the depth x depth kernels, normalized by the transform size
+	// NOTE: Also used by the HIP backend, whose hipFFT spectra have the same layout
+	void fillKernelSpectra(const RealFft2d& fft, int depth, int kernelRadius, const float* kernel, Complex* kernelSpectra, ThreadPool& threadPool);
+}
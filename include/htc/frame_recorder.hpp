@@ -0,0 +1,173 @@
+#pragma once
+
+#include "lve/pixel.hpp"
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+// Version written in new recordings, files with another version are rejected
+#define RECORDING_VERSION 1
+
+// A frame is stored whole every this many frames, seeking decodes at most this many frames
+#define RECORDING_KEYFRAME_INTERVAL 64
+
+// Number of threads compressing the frames
+#define RECORDING_WORKERS 2
+
+// zlib level of the frames, the deltas are mostly zeros and compress well even at low levels
+#define RECORDING_COMPRESSION_LEVEL 1
+
+
+namespace htc {
+
+	// Fixed header at the start of a recording, followed by the compressed frames then the index
+	// NOTE: The index is written when the recording is closed, a recording cut short has frameCount 0
+	struct RecordingHeader {
+		char magic[8];				// "LENIAREC"
+		uint32_t version;
+		uint32_t headerSize;		// sizeof(RecordingHeader) when written
+
+		uint32_t width;
+		uint32_t height;
+		uint32_t keyframeInterval;
+		uint32_t reserved;
+
+		uint64_t frameCount;
+		uint64_t indexOffset;		// Offset of frameCount RecordingIndexEntry
+	};
+
+	// Position of one compressed frame in the file
+	struct RecordingIndexEntry {
+		uint64_t offset;
+		uint32_t size;
+		uint32_t keyframe;			// 1 if the frame is not a delta
+	};
+
+	// Counters of a frame recorder, the times are totals in seconds
+	struct RecordingStatistics {
+		uint64_t recorded = 0;
+		uint64_t dropped = 0;			// Skipped because every frame buffer was still being compressed
+
+		double encodeSeconds = 0.0;		// Time the caller spent quantizing and delta encoding
+		double compressSeconds = 0.0;	// Time the workers spent compressing, summed over all of them
+
+		uint64_t rawBytes = 0;			// Size of the 8-bit frames
+		uint64_t compressedBytes = 0;
+	};
+
+	// Pack the colors of a frame as 8-bit RGB, 3 bytes per cell
+	void quantizeFrame(const lve::Pixel* frame, size_t count, uint8_t* rgb);
+
+	// Quantize the first three channels of a [channels][height][width] state the way colorKernel colors them
+	void quantizeState(const float* state, int channels, int width, int height, uint8_t* rgb);
+
+	// This class records the colored frames of a simulation into a compressed, seekable file
+	// recordFrame delta encodes the frame against the previous one, a pool of workers compresses
+	// the deltas with zlib and appends them in order to the file, along with an index of the frames
+	// NOTE: When all the frame buffers are busy, the frame is dropped instead of waiting
+	// the next frame is then encoded against the last recorded one, so the recording stays valid
+	class FrameRecorder {
+
+		public:
+
+			FrameRecorder(const std::string& path, int width, int height, int workerCount = RECORDING_WORKERS);
+
+			// Compress the pending frames, then write the index
+			~FrameRecorder();
+
+			// Not copyable or movable
+			FrameRecorder(const FrameRecorder&) = delete;
+			FrameRecorder& operator=(const FrameRecorder&) = delete;
+
+			// Queue a width * height 8-bit RGB frame, returns false if it was dropped
+			bool recordFrame(const uint8_t* rgb);
+
+			// Wait until every queued frame is in the file
+			void flush();
+
+			RecordingStatistics statistics() const;
+			void printStatistics() const;
+
+		private:
+
+			struct Frame {
+				uint64_t index;
+				bool keyframe;
+				std::vector<uint8_t> delta;
+				std::vector<uint8_t> compressed;
+			};
+
+			std::string path;
+			std::ofstream file;
+
+			int width;
+			int height;
+			size_t frameSize;
+
+			// Last recorded frame, the reference of the next delta
+			std::vector<uint8_t> previous;
+			uint64_t frameCount = 0;
+
+			// Frame buffers, each one is either free, queued or being compressed
+			std::vector<std::unique_ptr<Frame>> freeFrames;
+			std::deque<std::unique_ptr<Frame>> queue;
+			size_t pendingFrames = 0;
+
+			// The frames are appended in order, whatever the order in which they are compressed
+			// NOTE: The file has its own lock, so that recordFrame never waits on a write
+			std::mutex writeMutex;
+			std::condition_variable writeCondition;
+			uint64_t nextFrameToWrite = 0;
+			uint64_t writeOffset = 0;
+			std::vector<RecordingIndexEntry> index;
+			bool writeFailed = false;
+
+			RecordingStatistics counters;
+
+			mutable std::mutex mutex;
+			std::condition_variable queueCondition;
+			std::condition_variable idleCondition;
+			bool running = true;
+
+			std::vector<std::thread> workers;
+
+			void worker_loop();
+			void write_header();
+	};
+
+	// This class reads the frames of a recording, seeking through its index
+	class FrameReader {
+
+		public:
+
+			explicit FrameReader(const std::string& path);
+
+			const RecordingHeader& header() const { return recordingHeader; }
+
+			// Decode one frame into width * height * 3 bytes, starting from the keyframe before it
+			// NOTE: Reading the frames in order only decodes each of them once
+			void readFrame(uint64_t frame, uint8_t* rgb);
+
+		private:
+
+			std::string path;
+			std::ifstream file;
+
+			RecordingHeader recordingHeader;
+			std::vector<RecordingIndexEntry> index;
+
+			// Last decoded frame, reused when the next frame is read in order
+			std::vector<uint8_t> current;
+			int64_t currentFrame = -1;
+
+			void decode_frame(uint64_t frame);
+	};
+}
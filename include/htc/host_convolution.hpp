@@ -0,0 +1,99 @@
+#pragma once
+
+#include "htc/simulation_backend.hpp"
+#include "htc/direct_kernels.hpp"
+#include "htc/separable_kernel.hpp"
+#include "htc/thread_pool.hpp"
+
+#include <memory>
+#include <vector>
+
+
+namespace htc {
+
+	// This class is the interface of the convolution engines used by the CPU backend
+	// input and output are [depth][height][width] planes, the kernel uses the MIOpen filter layout
+	class HostConvolution {
+
+		public:
+
+			virtual ~HostConvolution() = default;
+
+			// output[target] = sum over the sources of input[source] correlated with kernel[target][source]
+			virtual void run(const float* input, float* output) = 0;
+
+			// Replace the kernel tensor, which keeps the same shape
+			virtual void setKernel(const float* kernel) = 0;
+	};
+
+	// This class computes the convolution with a sliding window over a padded copy of the input
+	// NOTE: Costs (2 * radius + 1)^2 multiply-adds per pixel and per pair of channels
+	class DirectConvolution : public HostConvolution {
+
+		public:
+
+			DirectConvolution(const SimulationConfig& config, int depth, const float* kernel, ThreadPool& threadPool);
+
+			void run(const float* input, float* output) override;
+			void setKernel(const float* kernel) override;
+
+		private:
+
+			ThreadPool& threadPool;
+
+			int width;
+			int height;
+			int depth;
+			int kernelRadius;
+			BoundaryMode boundary;
+
+			std::vector<float> kernel;
+			DirectRowKernel rowKernel;
+
+			// Input surrounded by kernelRadius cells of padding (zeros or wrapped values)
+			int paddedWidth;
+			int paddedHeight;
+			std::vector<float> paddedInput;
+
+			void pad_input(const float* input);
+	};
+
+	// This class computes the convolution with a low-rank separable approximation of the kernels
+	// each component is a horizontal pass over the padded source followed by a vertical pass accumulated in the target
+	// NOTE: Costs 2 * (2 * radius + 1) multiply-adds per pixel and per component
+	class SeparableConvolution : public HostConvolution {
+
+		public:
+
+			SeparableConvolution(const SimulationConfig& config, int depth, const float* kernel, ThreadPool& threadPool);
+
+			void run(const float* input, float* output) override;
+			void setKernel(const float* kernel) override;
+
+			const SeparableKernelTensor& kernels() const { return separableKernels; }
+
+		private:
+
+			ThreadPool& threadPool;
+
+			int width;
+			int height;
+			int depth;
+			int kernelRadius;
+			BoundaryMode boundary;
+			float tolerance;
+
+			SeparableKernelTensor separableKernels;
+
+			// Input surrounded by kernelRadius cells of padding (zeros or wrapped values)
+			int paddedWidth;
+			int paddedHeight;
+			std::vector<float> paddedInput;
+
+			// Result of the horizontal pass of one component, [paddedHeight][width]
+			std::vector<float> horizontalPass;
+	};
+
+	// Create the engine selected by config.convolution, which must not be ConvolutionMode::Auto
+	std::unique_ptr<HostConvolution> createHostConvolution(const SimulationConfig& config, int depth, const float* kernel, ThreadPool& threadPool);
+}
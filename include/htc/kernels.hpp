@@ -1,9 +1,15 @@
 #ifndef KERNELS_HPP
 #define KERNELS_HPP
 
-#include <lve/utils.hpp>
+#include "htc/parameters.hpp"
+#include "htc/precision.hpp"
+#include "htc/simulation_backend.hpp"
+
+#include "lve/pixel.hpp"
 
 #include <hip/hip_runtime.h>
+#include <hip/hip_fp16.h>
+#include <hip/hip_bfloat16.h>
 
 #define BLOCK_SIZE_X 32
 #define BLOCK_SIZE_Y 32
@@ -11,7 +17,91 @@
 // NOTE: Each block contains 1024 threads, which might be too many for some GPUs
 // NOTE: Might need to replace this with a dynamic approch
 
-__global__ void updateKernel(int width, int height, int depth, float* state, float* intermediate);
-__global__ void colorKernel(int width, int height, float* state, lve::Vertex* outputVertexArray);
+// Threads per block of the metrics reduction, must be a power of 2
+#define METRICS_BLOCK_SIZE 256
+
+// Conversions between the storage type of the state and fp32, all the computations run in fp32
+// NOTE: Both 16-bit conversions round to nearest even, like htc::floatToHalf and htc::floatToBfloat16
+__device__ inline float loadStorage(float value) { return value; }
+__device__ inline float loadStorage(__half value) { return __half2float(value); }
+__device__ inline float loadStorage(hip_bfloat16 value) { return static_cast<float>(value); }
+
+template <typename T> __device__ inline T storeStorage(float value);
+template <> __device__ inline float storeStorage<float>(float value) { return value; }
+template <> __device__ inline __half storeStorage<__half>(float value) { return __float2half(value); }
+template <> __device__ inline hip_bfloat16 storeStorage<hip_bfloat16>(float value) { return hip_bfloat16(value); }
+
+// Output of the color kernels, same as the host htc::writeCell
+// NOTE: The colors are rounded like htc::quantizeColor
+__device__ inline uint8_t quantizeColor(float value) {
+	return (uint8_t)(fminf(fmaxf(value, 0.0f), 1.0f) * 255.0f + 0.5f);
+}
+
+__device__ inline void writeCell(lve::Pixel& pixel, float r, float g, float b) {
+	pixel.r = quantizeColor(r);
+	pixel.g = quantizeColor(g);
+	pixel.b = quantizeColor(b);
+	pixel.a = 255;
+}
+
+// Call function with a value of the storage type of the precision, to select the instantiation of a kernel
+// e.g. dispatchStorage(precision, [&](auto storage) { using T = decltype(storage); ... updateKernel<T> ... });
+template <typename Function>
+inline void dispatchStorage(htc::Precision precision, Function&& function) {
+	switch (precision) {
+		case htc::Precision::Float16:
+			function(__half());
+			break;
+		case htc::Precision::BFloat16:
+			function(hip_bfloat16());
+			break;
+		default:
+			function(0.0f);
+			break;
+	}
+}
+
+// State kernels, the state holds a batch of worlds with one set of growth parameters each
+// NOTE: T is the storage type of the state and of the convolution output (float, __half or hip_bfloat16)
+// NOTE: The output holds the RGBA8 color of each cell, for both display modes
+template <typename T>
+__global__ void updateKernel(int width, int height, int depth, int batch, const htc::GrowthParameters* growth, T* state, T* intermediate);
+template <typename T>
+__global__ void colorKernel(int width, int height, int depth, T* state, lve::Pixel* output);
+
+// Update and color in a single pass, each thread handles all the channels of one cell
+template <typename T>
+__global__ void updateColorKernel(int width, int height, int depth, const htc::GrowthParameters* growth, T* state, T* intermediate, lve::Pixel* output);
+
+// Box or max reduction of the first world to the pixels of a display view, same as htc::colorViewRows
+// NOTE: filter is a htc::DownsampleFilter, columns and rows come from htc::DisplayFootprint
+template <typename T>
+__global__ void viewColorKernel(int width, int height, int depth, int filter, int viewWidth, int viewHeight,
+								const int* columns, const int* rows, const T* state, lve::Pixel* output);
+
+// Passes of one component of a separable convolution (separable mode)
+// NOTE: The boundaries are handled in the kernels, there is no padded copy of the input
+template <typename T>
+__global__ void separableRowKernel(int width, int height, int kernelRadius, int periodic, size_t inputWorldStride, size_t outputWorldStride,
+									const T* input, const float* filter, float* output);
+__global__ void separableColumnKernel(int width, int height, int kernelRadius, int periodic, size_t inputWorldStride, size_t outputWorldStride,
+										const float* input, const float* filter, float* output);
+
+// Copy planes between two layouts with different row pitches and plane heights, converting the values
+// blockIdx.z selects the plane (FFT and separable convolutions with a 16-bit state)
+template <typename Source, typename Destination>
+__global__ void convertPlanesKernel(int width, int height, int sourceWidth, int sourceHeight, int destinationWidth, int destinationHeight,
+									const Source* source, Destination* destination);
+
+// Sum and maximum of each plane of the state (world metrics)
+template <typename T>
+__global__ void metricsKernel(int planeSize, const T* state, float* mass, unsigned int* maximum);
+
+// Pointwise product of the kernel and input spectra, accumulated per target channel (FFT convolution)
+__global__ void spectrumMultiplyKernel(int spectrumSize, int depth, const float2* kernelSpectra, const float2* inputSpectra, float2* outputSpectra);
+
+// Colors of the output cells as 8-bit RGB, same as htc::quantizeFrame (frame recorder)
+// NOTE: The pixels are already quantized, only their alpha is dropped
+__global__ void quantizeFrameKernel(int count, const lve::Pixel* frame, uint8_t* rgb);
 
 #endif
\ No newline at end of file
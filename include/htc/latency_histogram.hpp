@@ -0,0 +1,92 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+// Sub-buckets per power of two, the relative error of a bucket is at most 1 / 2^LATENCY_SUB_BUCKET_BITS
+#define LATENCY_SUB_BUCKET_BITS 4
+
+// Buckets needed to cover every 64-bit duration in nanoseconds
+#define LATENCY_BUCKET_COUNT ((64 - LATENCY_SUB_BUCKET_BITS + 1) << LATENCY_SUB_BUCKET_BITS)
+
+// Seconds between two reports of the viewer
+#define LATENCY_REPORT_INTERVAL 5
+
+
+namespace htc {
+
+	// Percentiles of a set of durations, in nanoseconds
+	struct LatencySummary {
+		uint64_t count = 0;
+		double mean = 0.0;
+		double p50 = 0.0;
+		double p90 = 0.0;
+		double p99 = 0.0;
+		double p999 = 0.0;
+		double max = 0.0;
+	};
+
+	// Plain copy of the counters of a histogram, either since the start or over one interval
+	struct LatencyCounts {
+		std::array<uint64_t, LATENCY_BUCKET_COUNT> buckets{};
+		uint64_t count = 0;
+		uint64_t total = 0;
+		uint64_t maximum = 0;
+
+		LatencySummary summarize() const;
+	};
+
+	// This class counts durations in log-spaced buckets: exact below 2^LATENCY_SUB_BUCKET_BITS ns,
+	// then 2^LATENCY_SUB_BUCKET_BITS linear sub-buckets per power of two
+	// record is lock-free and allocation-free, any thread can call it
+	// NOTE: The counters are read without stopping the writers, a report can miss the durations recorded meanwhile
+	// NOTE: intervalCounts keeps the counts of its last call, it must only be called by one thread
+	class LatencyHistogram {
+
+		public:
+
+			explicit LatencyHistogram(const std::string& name);
+
+			// Not copyable or movable
+			LatencyHistogram(const LatencyHistogram&) = delete;
+			LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+			void record(int64_t nanoseconds);
+
+			// Counts since the creation of the histogram
+			LatencyCounts totalCounts() const;
+
+			// Counts since the previous call, or since the creation of the histogram
+			LatencyCounts intervalCounts();
+
+			const std::string& name() const { return histogramName; }
+
+			// Range of the durations counted by a bucket, upper bound excluded
+			static uint32_t bucketIndex(uint64_t nanoseconds);
+			static uint64_t bucketLowerBound(uint32_t index);
+			static uint64_t bucketUpperBound(uint32_t index);
+
+		private:
+
+			std::string histogramName;
+
+			std::array<std::atomic<uint64_t>, LATENCY_BUCKET_COUNT> buckets;
+			std::atomic<uint64_t> total{0};
+			std::atomic<uint64_t> maximum{0};
+			std::atomic<uint64_t> intervalMaximum{0};
+
+			LatencyCounts previousCounts;
+
+			void read_counts(LatencyCounts& counts) const;
+	};
+
+	// Print one line per histogram: count, mean and percentiles in milliseconds
+	void printLatencySummary(const std::string& name, const LatencySummary& summary);
+
+	// Write the summaries since the start of the histograms, as JSON if the path ends with .json, as CSV otherwise
+	void writeLatencyReport(const std::string& path, const std::vector<const LatencyHistogram*>& histograms);
+}
@@ -1,31 +1,65 @@
 #pragma once
 
 #include "htc/convolution_manager.hpp"
+#include "htc/simulation_backend.hpp"
+#include "htc/display.hpp"
+#include "htc/parameters.hpp"
 
-#include "lve/utils.hpp"
+#include "lve/pixel.hpp"
 
 #include <hip/hip_runtime.h>
 #include <optional>
-
-#define CHANNELS 3
+#include <vector>
 
 
 namespace htc {
 
 	// This class is responsible for managing the ressources and the execution of the graph
 	// that represents the Lenia simulation in the GPU
-	class LeniaGraph {
+	// NOTE: All the worlds of the batch are stepped by the same nodes, with one set of growth parameters each
+	// NOTE: With a 16-bit precision, the state and the convolution output are stored as __half or hip_bfloat16
+	class LeniaGraph : public SimulationBackend {
 
 		public:
 
-			LeniaGraph(int width, int height, lve::Vertex* templateVertexArray);
-			~LeniaGraph();
+			LeniaGraph(const SimulationConfig& config, lve::Pixel* templateOutput);
+			~LeniaGraph() override;
 
 			// Not copyable or movable
 			LeniaGraph(const LeniaGraph&) = delete;
 			LeniaGraph& operator=(const LeniaGraph&) = delete;
 
-			void step(lve::Vertex* outputVertexArray);
+			void step(lve::Pixel* output) override;
+
+			void runConvolution() override;
+			void runUpdate() override;
+			void runColor(lve::Pixel* output) override;
+			void runUpdateColor(lve::Pixel* output) override;
+
+			void setDisplayView(const DisplayView& view) override;
+
+			void setParameters(const LeniaParameters& parameters) override;
+			const LeniaParameters& parameters() const override { return leniaParameters; }
+
+			void setWorldGrowth(int world, const GrowthParameters& growth) override;
+			const GrowthParameters& growth(int world) const override;
+			void resetWorld(int world, uint64_t seed) override;
+
+			void readState(float* h_state) override;
+			void readWorldState(int world, float* h_state) override;
+			void writeWorldState(int world, const float* h_state) override;
+			std::vector<WorldMetrics> readMetrics() override;
+
+			int worldWidth() const override { return width; }
+			int worldHeight() const override { return height; }
+			int radius() const override { return kernelRadius; }
+			int channels() const override { return depth; }
+			int batchSize() const override { return batch; }
+			BoundaryMode boundaryMode() const override { return boundary; }
+			Precision storagePrecision() const override { return precision; }
+
+			bool usesDeviceMemory() const override { return true; }
+			const char* name() const override { return "hip"; }
 
 		private:
 
@@ -35,6 +69,7 @@ namespace htc {
 			hipStream_t stream;
 
 			// Graph nodes parameters
+			// NOTE: With the fused color pass, colorNode runs updateColorKernel and there is no update node
 			hipHostNodeParams convolutionNodeParams;
 			hipKernelNodeParams updateNodeParams;
 			hipKernelNodeParams colorNodeParams;
@@ -44,22 +79,54 @@ namespace htc {
 			hipGraphNode_t updateNode;
 			hipGraphNode_t colorNode;
 
+			ColorPass colorPass;
+			Precision precision;
+
 			hipGraph_t graph;
 			hipGraphExec_t graphExec;
 
+			// Convolution and update only, used when there is no output
+			hipGraph_t headlessGraph;
+			hipGraphExec_t headlessGraphExec;
+
 			int width;
 			int height;
 
-			int depth = CHANNELS;
-
-			// State of the simulation
-			float* d_state;
-			float* d_intermediate;
-
-			void init_state();
-
-			void createConvolutionNode();
-			void createUpdateNode();
-			void createColorNode(lve::Vertex* templateVertexArray);
+			int depth;
+			int batch;
+
+			int kernelRadius;
+			BoundaryMode boundary;
+			LeniaParameters leniaParameters;
+
+			// Growth parameters of each world, read by the update kernels
+			std::vector<GrowthParameters> worldGrowth;
+			GrowthParameters* d_growth;
+
+			// State of the simulation, [world][channel][height][width], in the storage type of the precision
+			void* d_state;
+			void* d_intermediate;
+
+			// Per plane reduction results of readMetrics
+			float* d_mass;
+			unsigned int* d_maximum;
+
+			// Cells drawn by each pixel of the output, the graph colors the cells in place and is only used with one pixel per cell
+			// NOTE: The ranges of the pixels are uploaded once per view, the memory is only allocated for a view other than the default one
+			DisplayFootprint footprint;
+			int* d_viewColumns = nullptr;
+			int* d_viewRows = nullptr;
+
+			void init_state(uint64_t seed);
+			void upload_growth();
+			void check_world(int world) const;
+			void read_worlds(int firstWorld, int worldCount, float* h_state);
+			void color_view(lve::Pixel* output);
+
+			void createConvolutionNode(const SimulationConfig& config, const float* h_kernel);
+			void createUpdateNode(hipGraph_t targetGraph, hipGraphNode_t dependency, hipGraphNode_t* node);
+			void createColorNode(lve::Pixel* templateOutput);
+			void createUpdateColorNode(lve::Pixel* templateOutput);
+			void createHeadlessGraph();
 	};
 }
\ No newline at end of file
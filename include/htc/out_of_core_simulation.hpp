@@ -0,0 +1,164 @@
+#pragma once
+
+#include "htc/simulation_backend.hpp"
+#include "htc/display.hpp"
+#include "htc/direct_kernels.hpp"
+#include "htc/thread_pool.hpp"
+#include "htc/parameters.hpp"
+
+#include "lve/pixel.hpp"
+
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+namespace htc {
+
+	// This class runs the Lenia simulation on the CPU with the worlds stored in a memory-mapped file, for worlds larger than RAM
+	// each world is split into tile rows (bands of full rows) swept from top to bottom: only the band being processed
+	// and the next one, loaded in the background, are resident with their halo of kernelRadius rows
+	// NOTE: The file holds two copies of the batch, each step reads one and writes the other, so a band is never read
+	// after it has been overwritten
+	// NOTE: The windows are loaded by a single loader thread that lives as long as the backend, the state is read
+	// back (checkpoints, snapshots, metrics) one band at a time from the file
+	// NOTE: Only the direct convolution is supported, the results are identical to the CPU backend
+	// NOTE: Like the CPU backend, the 16-bit precisions only round the values, the worlds stay in fp32
+	class OutOfCoreSimulation : public SimulationBackend {
+
+		public:
+
+			OutOfCoreSimulation(const SimulationConfig& config);
+			~OutOfCoreSimulation() override;
+
+			// Not copyable or movable
+			OutOfCoreSimulation(const OutOfCoreSimulation&) = delete;
+			OutOfCoreSimulation& operator=(const OutOfCoreSimulation&) = delete;
+
+			void step(lve::Pixel* output) override;
+
+			// The convolution is stored in the copy that the next step writes, the update then works in place
+			void runConvolution() override;
+			void runUpdate() override;
+			void runColor(lve::Pixel* output) override;
+			void runUpdateColor(lve::Pixel* output) override;
+
+			void setDisplayView(const DisplayView& view) override;
+
+			void setParameters(const LeniaParameters& parameters) override;
+			const LeniaParameters& parameters() const override { return leniaParameters; }
+
+			void setWorldGrowth(int world, const GrowthParameters& growth) override;
+			const GrowthParameters& growth(int world) const override;
+			void resetWorld(int world, uint64_t seed) override;
+
+			void readState(float* h_state) override;
+			void readWorldState(int world, float* h_state) override;
+			void streamWorldState(int world, const std::function<void(const float* values, size_t count)>& consume) override;
+			bool streamsState() const override { return true; }
+			void writeWorldState(int world, const float* h_state) override;
+			std::vector<WorldMetrics> readMetrics() override;
+
+			int worldWidth() const override { return width; }
+			int worldHeight() const override { return height; }
+			int radius() const override { return kernelRadius; }
+			int channels() const override { return depth; }
+			int batchSize() const override { return batch; }
+			BoundaryMode boundaryMode() const override { return boundary; }
+			Precision storagePrecision() const override { return precision; }
+
+			bool usesDeviceMemory() const override { return false; }
+			const char* name() const override { return "out-of-core"; }
+
+			int tileRowHeight() const { return bandRows; }
+
+		private:
+
+			ThreadPool threadPool;
+
+			int width;
+			int height;
+
+			int depth;
+			int batch;
+
+			int kernelRadius;
+			int kernelSize;
+
+			BoundaryMode boundary;
+			ColorPass colorPass;
+			Precision precision;
+
+			DisplayFootprint footprint;
+
+			LeniaParameters leniaParameters;
+			std::vector<GrowthParameters> worldGrowth;
+			std::vector<float> kernel;
+			DirectRowKernel rowKernel;
+
+			// Tile rows of a world, a band of rows stored as [channel][row][width] so that it is contiguous in the file
+			int bandRows;
+			int bandCount;
+			int bandReach;		// Bands within the kernel radius of a band, on each side
+
+			// Two copies of [world][band][channel][row][width] in the file, the state is in copy current
+			std::string worldFilePath;
+			float* mapping = nullptr;
+			size_t mappingSize = 0;
+			size_t worldSize;
+			size_t copySize;
+			int current = 0;
+
+			// Resident part of the worlds, [channel][bandRows + 2 * radius][width + 2 * radius] for the processed band and the next one
+			std::vector<float> windows[2];
+			std::vector<float> bandIntermediate;
+
+			// Window requested from the loader thread, at most one at a time: the other window is being processed
+			std::thread loaderThread;
+			std::mutex loaderMutex;
+			std::condition_variable loaderCondition;
+			bool loaderRunning = true;
+			bool loadPending = false;
+			int loadWorld = 0;
+			int loadBand = 0;
+			float* loadWindow = nullptr;
+			std::exception_ptr loadError;
+
+			void init_file();
+			void check_world(int world) const;
+
+			int band_height(int band) const;
+			float* band_data(int copy, int world, int band) const;
+			float* row_data(int copy, int world, int channel, int y) const;
+
+			// Hint the kernel about the pages of a band, the released pages are read again from the file when needed
+			void prefetch_band(int copy, int world, int band) const;
+			void release_band(int copy, int world, int band) const;
+
+			// Copy a band of the state with its halo, the boundary mode decides what is read outside of the world
+			void load_window(int world, int band, float* window) const;
+
+			// Hand a window to the loader thread, and wait for the requested one to be loaded (rethrows its error)
+			void loader_loop();
+			void request_load(int world, int band, float* window);
+			void wait_load();
+
+			// Visit the bands of every world in order, the window of the next band is loaded while a band is processed
+			void sweep_windows(const std::function<void(int world, int band, const float* window)>& process);
+
+			void convolve_band(const float* window, int rows, float* output);
+			void update_band(int world, int band, const float* state, const float* intermediate, float* updated);
+
+			// Color the pixel rows of the view whose cells are all above the end of the band, from the next pixel row
+			void color_band(int copy, int band, lve::Pixel* output, int& nextPixelRow);
+			void update_color(lve::Pixel* output);
+	};
+
+	// Rows of the tile rows whose window, convolution output and prefetched window fit in the memory budget
+	int defaultTileRowHeight(const SimulationConfig& config);
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Simulation dimensions
+#define CHANNELS 3
+
+// Default kernel radius, the ring shapes are defined for this radius and scaled for the others
+#define KERNEL_RADIUS 15
+
+// Lenia growth parameters
+#define GROWTH_MU 20.0f
+#define GROWTH_SIGMA 5.0f
+#define GROWTH_ALPHA 0.1f
+
+// Default relative error allowed for the separable approximation of the kernels
+#define SEPARABLE_TOLERANCE 1e-3f
+
+
+namespace htc {
+
+	// Gaussian ring feeding targetChannel from sourceChannel
+	// NOTE: mu and sigma are given for a kernel of KERNEL_RADIUS and scaled with the actual radius
+	struct KernelRing {
+		int source;
+		int target;
+		float mu;
+		float sigma;
+		float weight = 1.0f;
+	};
+
+	// Growth function and time step
+	// NOTE: Each world of a batch can have its own
+	struct GrowthParameters {
+		float mu = GROWTH_MU;
+		float sigma = GROWTH_SIGMA;
+		float timeStep = GROWTH_ALPHA;
+	};
+
+	// Parameters of the simulation that can be changed while it runs
+	struct LeniaParameters {
+		std::vector<KernelRing> rings;
+		GrowthParameters growth;
+	};
+
+	// Each channel feeds itself and its two neighbours with rings of increasing radius
+	LeniaParameters defaultParameters(int depth);
+
+	// Read a parameter file, one entry per line, '#' starts a comment:
+	//     growth_mu <value>
+	//     growth_sigma <value>
+	//     time_step <value>
+	//     ring <source> <target> <mu> <sigma> [weight]
+	// NOTE: The growth entries that are missing keep their default value, there are no default rings
+	LeniaParameters loadParameters(const std::string& path);
+
+	// Add a gaussian ring to the kernel going from sourceChannel to targetChannel
+	// NOTE: h_kernel uses the MIOpen filter layout: [target][source][2 * radius + 1][2 * radius + 1]
+	void fillGaussianKernel(int depth, int kernelRadius, int sourceChannel, int targetChannel, float mu, float sigma, float weight, float* h_kernel);
+
+	// Fill the whole kernel tensor with the given rings, shared by every simulation backend
+	// NOTE: Rings are scaled with the radius and reweighted so that the kernel mass doesn't change
+	void initKernelTensor(int depth, int kernelRadius, const std::vector<KernelRing>& rings, float* h_kernel);
+
+	// Same with the default rings
+	void initKernelTensor(int depth, int kernelRadius, float* h_kernel);
+}
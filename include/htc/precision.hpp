@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+
+namespace htc {
+
+	// Storage format of the state and of the convolution output
+	// NOTE: All the computations accumulate in fp32, only the stored values are rounded
+	enum class Precision {
+		Float32,
+		Float16,	// IEEE half: 10 bits of mantissa, down to 6e-8 with subnormals
+		BFloat16	// Truncated fp32: 7 bits of mantissa, same range as fp32
+	};
+
+	Precision parsePrecision(const std::string& name);
+	const char* precisionName(Precision precision);
+
+	// Bytes per stored value
+	size_t precisionSize(Precision precision);
+
+	// Conversions with round to nearest even, matching the device conversions
+	uint16_t floatToHalf(float value);
+	float halfToFloat(uint16_t value);
+	uint16_t floatToBfloat16(float value);
+	float bfloat16ToFloat(uint16_t value);
+
+	// Convert between fp32 and the storage format, the 16-bit formats are stored as uint16_t
+	void convertToStorage(Precision precision, const float* values, size_t count, void* storage);
+	void convertFromStorage(Precision precision, const void* storage, size_t count, float* values);
+
+	// Round fp32 values to the nearest value of the storage format, in place
+	// NOTE: Used by the CPU backend to reproduce the numerics of the 16-bit storage
+	void roundToPrecision(Precision precision, float* values, size_t count);
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "htc/simulation_backend.hpp"
+#include "htc/precision.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+// Description of the golden run, next to its snapshots
+#define GOLDEN_MANIFEST_NAME "golden.txt"
+
+// Default length of a golden run, the default thresholds are measured over it
+#define GOLDEN_STEPS 200
+
+
+namespace htc {
+
+	// Difference between a state and its reference
+	struct StateError {
+		double maxError = 0.0;
+		double rmsError = 0.0;
+		double massDrift = 0.0;		// Relative difference of the total mass
+	};
+
+	// Compare count values of a state with the same values of the reference
+	StateError measureStateError(const float* reference, const float* state, size_t count);
+
+	// Default thresholds of a check of the engine against a golden run of the direct fp32 convolution
+	// NOTE: The differences of the modes that round another way grow chaotically with the steps, the thresholds
+	// are a few times what they reach over GOLDEN_STEPS steps of the default 128x128 golden run, a longer run needs looser ones
+	StateError goldenThresholds(ConvolutionMode convolution, Precision precision);
+
+	// Run that produced a set of golden snapshots, each one is a checkpoint of that run
+	// the checkpoints hold the shape, the boundary mode and the parameters, the manifest the seed that the states start from
+	struct GoldenManifest {
+		uint64_t seed = 0;
+		std::string reference;			// Backend, convolution and precision of the recorded run, only informative
+		std::vector<uint64_t> steps;	// Steps of the snapshots, in increasing order
+	};
+
+	void writeGoldenManifest(const std::string& directory, const GoldenManifest& manifest);
+	GoldenManifest readGoldenManifest(const std::string& directory);
+
+	// Checkpoint of the golden run at the given step
+	std::string goldenSnapshotPath(const std::string& directory, uint64_t step);
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <vector>
+
+
+namespace htc {
+
+	// Rank-k approximation of a square 2D kernel as a sum of separable filters
+	// kernel[ky][kx] ~= sum over i of vertical[i][ky] * horizontal[i][kx]
+	struct SeparableKernel {
+		int rank = 0;
+		std::vector<float> vertical;		// [rank][kernelSize]
+		std::vector<float> horizontal;		// [rank][kernelSize]
+
+		// Frobenius norm of the residual over the norm of the kernel
+		float relativeError = 0.0f;
+	};
+
+	// Separable approximation of the whole depth x depth kernel tensor
+	struct SeparableKernelTensor {
+		int kernelSize = 0;
+		std::vector<SeparableKernel> pairs;		// [target][source]
+
+		int components = 0;					// Sum of the ranks of all the pairs
+		float maxRelativeError = 0.0f;		// Worst pair
+	};
+
+	// Factor one kernel with a Jacobi SVD, keeping the fewest singular values that reach the tolerance
+	// NOTE: A kernel of zeros has rank 0
+	SeparableKernel factorKernel(const float* kernel, int kernelSize, float tolerance);
+
+	// Factor every pair of a kernel tensor in the MIOpen filter layout
+	SeparableKernelTensor factorKernelTensor(int depth, int kernelRadius, const float* kernel, float tolerance);
+
+	// Print the ranks and the approximation error reached, so that the accuracy of the mode is visible
+	void printSeparableKernelReport(const SeparableKernelTensor& kernels, float tolerance);
+}
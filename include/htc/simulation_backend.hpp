@@ -0,0 +1,289 @@
+#pragma once
+
+#include "htc/latency_histogram.hpp"
+#include "htc/parameters.hpp"
+#include "htc/precision.hpp"
+
+#include "lve/pixel.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+
+namespace htc {
+
+	// Available implementations of the simulation
+	// NOTE: Auto selects the HIP backend when a device is present and falls back to the CPU otherwise
+	enum class BackendType {
+		Auto,
+		Hip,
+		Cpu,
+		Tiled,		// CPU backend with the worlds split into tiles that fit in the L2 cache
+		OutOfCore	// CPU backend with the worlds stored in a file, streamed through memory one tile row at a time
+	};
+
+	// Algorithms available to compute the convolution
+	enum class ConvolutionMode {
+		Direct,		// O(R^2) per pixel: MIOpen on the GPU, sliding window on the CPU
+		Fft,		// Nearly constant cost per pixel, with the kernel spectra computed once
+		Separable,	// O(kR) per pixel, the kernels are approximated by k separable filters (low-rank SVD)
+		Auto		// Fastest of the above for the shape of the world, found by the autotuner
+	};
+
+	// Use of the tuning database by the autotuner
+	enum class TuningMode {
+		Cached,		// Reuse the stored winners, only search the shapes that are not in the database yet
+		Search,		// Search again and replace the stored winners
+		Off			// Search when needed without reading or writing the database
+	};
+
+	// What the kernel sees past the edges of the world
+	enum class BoundaryMode {
+		Zero,		// Zero padding, like the MIOpen convolution
+		Periodic	// The world wraps around (torus)
+	};
+
+	// How the update and the coloring of the output vertices are scheduled
+	enum class ColorPass {
+		Fused,		// One pass, the colors are written while the updated state is still in registers
+		Separate	// Two passes, the state is written then read back to color the vertices
+	};
+
+	// Drawing of the colored output of a step, both modes read the same lve::Pixel per cell
+	enum class DisplayMode {
+		Points,		// One point per cell, at a static position
+		Texture		// Cells looked up by a fullscreen triangle
+	};
+
+	// Reduction of the cells covered by one pixel when the view shows more cells than pixels
+	enum class DownsampleFilter {
+		Box,		// Mean of the cells, the density of a region
+		Max			// Largest cell, small creatures stay visible on a large world
+	};
+
+	// Handoff of the frames between the simulation and the display of the viewer
+	enum class FrameSchedule {
+		Lockstep,	// Every colored frame is shown, the simulation waits when the display falls behind
+		Mailbox		// Only the newest frame is shown, an unconsumed frame is replaced and the simulation never waits
+	};
+
+	// Parameters used to build a simulation backend
+	struct SimulationConfig {
+		int width;
+		int height;
+
+		BackendType backend = BackendType::Auto;
+
+		// Number of independent worlds stepped together, they share the kernels
+		int batchSize = 1;
+
+		// World i starts from the seed + i, 0 picks a random seed
+		uint64_t seed = 0;
+
+		int channels = CHANNELS;
+		int kernelRadius = KERNEL_RADIUS;
+		ConvolutionMode convolution = ConvolutionMode::Direct;
+		BoundaryMode boundary = BoundaryMode::Zero;
+		ColorPass colorPass = ColorPass::Fused;
+		DisplayMode display = DisplayMode::Texture;
+		DownsampleFilter downsample = DownsampleFilter::Box;
+
+		// Steps run for each frame handed to the viewer, only the last one is colored
+		FrameSchedule schedule = FrameSchedule::Lockstep;
+		int stepsPerFrame = 1;
+
+		// Storage format of the state and of the convolution output
+		// NOTE: Only the HIP backend stores 16 bits, the CPU backends keep fp32 buffers and only emulate the rounding
+		// to compare with the GPU, their 16-bit modes save no memory or bandwidth and cost an extra rounding pass
+		Precision precision = Precision::Float32;
+
+		// Relative error allowed when approximating the kernels in the separable mode
+		float separableTolerance = SEPARABLE_TOLERANCE;
+
+		// Parameter file read at startup, the default parameters are used if empty
+		std::string parametersPath;
+
+		// Number of worker threads used by the CPU backends (0: one per hardware thread)
+		int threadCount = 0;
+
+		// Side of the tiles of the tiled backend (0: sized for the L2 cache)
+		// or rows of the tile rows of the out-of-core backend (0: sized for its memory budget)
+		int tileSize = 0;
+
+		// File holding the worlds of the out-of-core backend, overwritten (empty: a temporary file, removed at exit)
+		std::string worldFilePath;
+
+		// Values and changes under which a tile of the tiled backend is left asleep (0: every tile is stepped)
+		// NOTE: A world made of a single tile is always stepped, tileSize must be smaller than the world
+		float activityEpsilon = 0.0f;
+
+		// Compressed snapshots written in the background every snapshotInterval steps (0: disabled)
+		std::string snapshotDirectory = "snapshots";
+		int snapshotInterval = 0;
+
+		// 8-bit recording of the colored frames (empty: disabled)
+		std::string recordPath;
+
+		// Chrome trace of the instrumented stages, written when the program exits (empty: disabled)
+		std::string tracePath;
+
+		// Latency percentiles printed every latencyInterval seconds (0: only at the end), and written when the program exits (empty: not written)
+		int latencyInterval = LATENCY_REPORT_INTERVAL;
+		std::string latencyReportPath;
+
+		// Winners of the autotuner, reused by the later runs (empty: the default database in the user cache directory)
+		TuningMode tuning = TuningMode::Cached;
+		std::string tuningDatabasePath;
+	};
+
+	// Summary of the state of one world, per channel
+	struct WorldMetrics {
+		std::vector<float> mass;		// Sum of the state
+		std::vector<float> maximum;
+	};
+
+	// Part of the first world drawn by the color passes, and size of their output in pixels
+	// NOTE: The default view draws the whole world with one pixel per cell
+	struct DisplayView {
+		int width = 0;				// Size of the output, 0 for the size of the world
+		int height = 0;
+		float centerX = 0.5f;		// Center of the view, in fractions of the world
+		float centerY = 0.5f;
+		float zoom = 1.0f;			// 1 shows the whole world, 2 half of it along each axis
+		DownsampleFilter filter = DownsampleFilter::Box;
+	};
+
+	// This class is the interface shared by all the implementations of the Lenia simulation
+	// each step runs the convolution, the update and the coloring of the output
+	// NOTE: A batch of worlds is stored as a [world][channel][height][width] tensor, only the first world is colored
+	// NOTE: The output holds one RGBA8 lve::Pixel per cell, or per pixel of the display view when one is set
+	class SimulationBackend {
+
+		public:
+
+			virtual ~SimulationBackend() = default;
+
+			// Advance the simulation by one step and write the colored cells to output
+			// NOTE: output can be nullptr to skip the coloring (headless runs)
+			virtual void step(lve::Pixel* output) = 0;
+
+			// Individual stages of step(), each one waits for its completion
+			// NOTE: Used to profile the pipeline, step() is faster than calling them in sequence
+			virtual void runConvolution() = 0;
+			virtual void runUpdate() = 0;
+			virtual void runColor(lve::Pixel* output) = 0;
+			virtual void runUpdateColor(lve::Pixel* output) = 0;
+
+			// Draw another part of the world, or draw it at another resolution, from the next colored step
+			// NOTE: The output of step, runColor and runUpdateColor then holds view.width x view.height pixels
+			virtual void setDisplayView(const DisplayView& view) = 0;
+
+			// Replace the kernel rings and the growth parameters between two steps
+			// NOTE: The existing resources are patched in place, the state is kept
+			virtual void setParameters(const LeniaParameters& parameters) = 0;
+			virtual const LeniaParameters& parameters() const = 0;
+
+			// Growth parameters of a single world, setParameters resets all the worlds to the same ones
+			virtual void setWorldGrowth(int world, const GrowthParameters& growth) = 0;
+			virtual const GrowthParameters& growth(int world) const = 0;
+
+			// Restart a world from the random state generated by the seed
+			virtual void resetWorld(int world, uint64_t seed) = 0;
+
+			// Copy the [world][channels][height][width] state of the whole batch to host memory
+			virtual void readState(float* h_state) = 0;
+
+			// Copy the [channels][height][width] state of one world to host memory
+			virtual void readWorldState(int world, float* h_state) = 0;
+
+			// Hand the [channels][height][width] state of one world to consume in order, in chunks of whole rows
+			// NOTE: The default copies the whole world with readWorldState, the backends that stream their state
+			// hand it one part at a time so that it is never all in memory
+			virtual void streamWorldState(int world, const std::function<void(const float* values, size_t count)>& consume);
+
+			// True if the state doesn't fit in memory, it must then be read with streamWorldState
+			virtual bool streamsState() const { return false; }
+
+			// Replace the state of one world with [channels][height][width] values from host memory
+			// NOTE: h_state can point to a file mapping, it is read once and not kept
+			virtual void writeWorldState(int world, const float* h_state) = 0;
+
+			// Metrics of every world, computed where the state lives
+			virtual std::vector<WorldMetrics> readMetrics() = 0;
+
+			// Shape of the worlds and radius of the kernels, in cells
+			virtual int worldWidth() const = 0;
+			virtual int worldHeight() const = 0;
+			virtual int radius() const = 0;
+			virtual int channels() const = 0;
+			virtual int batchSize() const = 0;
+
+			// Boundary mode and storage format the backend was created with
+			virtual BoundaryMode boundaryMode() const = 0;
+			virtual Precision storagePrecision() const = 0;
+
+			// True if the output must be device memory, false if it must be host memory
+			virtual bool usesDeviceMemory() const = 0;
+
+			virtual const char* name() const = 0;
+
+			// Fraction of the cells stepped by the last step, only below 1 for the backends that skip quiescent regions
+			virtual double activeFraction() const { return 1.0; }
+	};
+
+	BackendType parseBackendType(const std::string& name);
+	ConvolutionMode parseConvolutionMode(const std::string& name);
+	BoundaryMode parseBoundaryMode(const std::string& name);
+	ColorPass parseColorPass(const std::string& name);
+	DisplayMode parseDisplayMode(const std::string& name);
+	FrameSchedule parseFrameSchedule(const std::string& name);
+	DownsampleFilter parseDownsampleFilter(const std::string& name);
+	TuningMode parseTuningMode(const std::string& name);
+
+	const char* convolutionModeName(ConvolutionMode mode);
+	const char* boundaryModeName(BoundaryMode mode);
+
+	// Parse the command line option at argv[index] into config, shared by all the executables
+	// returns false if the option is not a simulation option, otherwise index points to its last argument
+	bool parseSimulationArgument(int argc, char** argv, int& index, SimulationConfig& config);
+
+	// Parameters a backend starts with: the parameter file of the config or the default ones
+	LeniaParameters initialParameters(const SimulationConfig& config);
+
+	// Seed of the first world: the one of the config, or a random one
+	// NOTE: Store the result in config.seed before creating a backend and print it, so that the run can be reproduced
+	uint64_t initialSeed(const SimulationConfig& config);
+
+	// Fill the state of one world with uniform random values in [0, 1), the same for every backend, compiler and platform
+	void fillRandomState(uint64_t seed, size_t count, float* h_state);
+
+	// This class generates the values of fillRandomState in pieces, for the backends that can't hold a whole world
+	// NOTE: Filling n then m values gives the same values as filling n + m values at once
+	class RandomStateStream {
+
+		public:
+
+			explicit RandomStateStream(uint64_t seed) : generator(seed) {}
+
+			void fill(size_t count, float* h_state);
+
+		private:
+
+			std::mt19937_64 generator;
+	};
+
+	// Usage string of the options handled by parseSimulationArgument
+	const char* simulationArgumentsUsage();
+
+	// Check at runtime if this build and this machine can run the HIP backend
+	bool isHipBackendAvailable();
+
+	// Create the backend requested by the config
+	// NOTE: templateOutput is only used by the HIP backend to build its graph
+	std::unique_ptr<SimulationBackend> createSimulationBackend(const SimulationConfig& config, lve::Pixel* templateOutput = nullptr);
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "htc/simulation_backend.hpp"
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+// Snapshots waiting to be written, captures are dropped past this depth
+#define SNAPSHOT_QUEUE_DEPTH 2
+
+// zlib level of the snapshots, favors speed since the state compresses poorly anyway
+#define SNAPSHOT_COMPRESSION_LEVEL 1
+
+
+namespace htc {
+
+	// Counters of a snapshot writer, the times are totals in seconds
+	struct SnapshotStatistics {
+		uint64_t captured = 0;			// Copied from the simulation and queued
+		uint64_t dropped = 0;			// Skipped because every staging buffer was still queued or being written
+		uint64_t written = 0;
+		uint64_t failed = 0;
+
+		size_t maxQueueDepth = 0;		// Highest number of snapshots waiting at once
+
+		double captureSeconds = 0.0;	// Time the simulation spent copying its state
+		double writeSeconds = 0.0;		// Time the I/O thread spent compressing and writing
+
+		uint64_t rawBytes = 0;
+		uint64_t compressedBytes = 0;
+	};
+
+	// This class writes gzip compressed checkpoints of a running simulation on a background thread
+	// capture only copies the state into a pooled staging buffer, the compression and the file system
+	// are left to the I/O thread, so the step loop never waits on them
+	// NOTE: When all the staging buffers are busy, the capture is dropped instead of waiting (back-pressure)
+	// NOTE: A snapshot is a checkpoint once decompressed: gunzip snapshot_*.lenia.gz and restore it
+	// NOTE: A backend that streams its state has no staging buffer, a copy of it would not fit in memory:
+	// capture writes the snapshot itself, one part of a world at a time, and the step loop waits for it
+	class SnapshotWriter {
+
+		public:
+
+			SnapshotWriter(const std::string& directory, const SimulationBackend& simulation, int queueDepth = SNAPSHOT_QUEUE_DEPTH);
+
+			// Write the queued snapshots, then stop the I/O thread
+			~SnapshotWriter();
+
+			// Not copyable or movable
+			SnapshotWriter(const SnapshotWriter&) = delete;
+			SnapshotWriter& operator=(const SnapshotWriter&) = delete;
+
+			// Copy the state of the simulation and queue it, returns false if it was dropped
+			// NOTE: Must be called between two steps, from the thread that steps the simulation
+			bool capture(SimulationBackend& simulation, uint64_t step);
+
+			// Wait until every queued snapshot is written
+			void flush();
+
+			SnapshotStatistics statistics() const;
+			void printStatistics() const;
+
+		private:
+
+			struct Snapshot {
+				uint64_t step;
+				std::vector<char> metadata;
+				std::vector<float> state;
+			};
+
+			// Receives the state of the batch in order, one chunk at a time
+			using StateSink = std::function<void(const float* values, size_t count)>;
+
+			std::string directory;
+			size_t stateSize;
+			bool streamed;
+
+			// Staging buffers, each one is either free, queued or being written
+			std::vector<std::unique_ptr<Snapshot>> freeSnapshots;
+			std::deque<std::unique_ptr<Snapshot>> queue;
+			bool writing = false;
+
+			SnapshotStatistics counters;
+
+			mutable std::mutex mutex;
+			std::condition_variable queueCondition;
+			std::condition_variable idleCondition;
+			bool running = true;
+
+			std::thread ioThread;
+
+			void io_loop();
+			bool capture_streamed(SimulationBackend& simulation, uint64_t step);
+			bool write_snapshot(uint64_t step, const std::vector<char>& metadata, const std::function<void(const StateSink&)>& writeState,
+								uint64_t& compressedBytes);
+	};
+}
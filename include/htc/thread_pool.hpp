@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+namespace htc {
+
+	// This class keeps a set of worker threads alive and splits loops between them
+	// the calling thread takes part in the work, so a pool of N threads spawns N - 1 workers
+	// NOTE: parallelFor is not reentrant, the body must not call parallelFor on the same pool
+	class ThreadPool {
+
+		public:
+
+			// threadCount = 0 uses one thread per hardware thread
+			explicit ThreadPool(int threadCount = 0);
+			~ThreadPool();
+
+			// Not copyable or movable
+			ThreadPool(const ThreadPool&) = delete;
+			ThreadPool& operator=(const ThreadPool&) = delete;
+
+			// Call body(begin, end) on chunks covering [0, count) and wait for all of them
+			void parallelFor(int count, const std::function<void(int, int)>& body);
+
+			int size() const { return threadCount; }
+
+		private:
+
+			void workerLoop();
+			void runChunks();
+
+			int threadCount;
+			std::vector<std::thread> workers;
+
+			// Current job
+			const std::function<void(int, int)>* job = nullptr;
+			int jobCount = 0;
+			int chunkSize = 1;
+			std::atomic<int> nextChunk{0};
+
+			// Synchronization
+			std::mutex mutex;
+			std::condition_variable startCondition;
+			std::condition_variable doneCondition;
+			uint64_t generation = 0;
+			int pendingWorkers = 0;
+			bool running = true;
+	};
+}
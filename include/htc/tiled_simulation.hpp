@@ -0,0 +1,156 @@
+#pragma once
+
+#include "htc/simulation_backend.hpp"
+#include "htc/display.hpp"
+#include "htc/direct_kernels.hpp"
+#include "htc/thread_pool.hpp"
+#include "htc/parameters.hpp"
+
+#include "lve/pixel.hpp"
+
+#include <cstddef>
+#include <vector>
+
+
+namespace htc {
+
+	// This class runs the Lenia simulation on the CPU with the worlds split into square tiles
+	// each tile keeps its own state surrounded by a halo of kernelRadius cells, refreshed from the neighbouring tiles
+	// every step, then convolves and updates its interior while it is still in the L2 cache of its thread
+	// NOTE: Only the direct convolution is supported, the results are identical to the CPU backend
+	// NOTE: Like the CPU backend, the 16-bit precisions only round the values, the worlds stay in fp32
+	// NOTE: With an activity epsilon, the quiescent tiles are skipped: a tile is only stepped if it, or a tile within
+	// the kernel radius, held a value or changed by more than epsilon in its last update
+	class TiledSimulation : public SimulationBackend {
+
+		public:
+
+			TiledSimulation(const SimulationConfig& config);
+			~TiledSimulation() override = default;
+
+			// Not copyable or movable
+			TiledSimulation(const TiledSimulation&) = delete;
+			TiledSimulation& operator=(const TiledSimulation&) = delete;
+
+			void step(lve::Pixel* output) override;
+
+			void runConvolution() override;
+			void runUpdate() override;
+			void runColor(lve::Pixel* output) override;
+			void runUpdateColor(lve::Pixel* output) override;
+
+			void setDisplayView(const DisplayView& view) override;
+
+			void setParameters(const LeniaParameters& parameters) override;
+			const LeniaParameters& parameters() const override { return leniaParameters; }
+
+			void setWorldGrowth(int world, const GrowthParameters& growth) override;
+			const GrowthParameters& growth(int world) const override;
+			void resetWorld(int world, uint64_t seed) override;
+
+			void readState(float* h_state) override;
+			void readWorldState(int world, float* h_state) override;
+			void writeWorldState(int world, const float* h_state) override;
+			std::vector<WorldMetrics> readMetrics() override;
+
+			int worldWidth() const override { return width; }
+			int worldHeight() const override { return height; }
+			int radius() const override { return kernelRadius; }
+			int channels() const override { return depth; }
+			int batchSize() const override { return batch; }
+			BoundaryMode boundaryMode() const override { return boundary; }
+			Precision storagePrecision() const override { return precision; }
+
+			bool usesDeviceMemory() const override { return false; }
+			const char* name() const override { return "tiled"; }
+
+			int tileSize() const { return tileSide; }
+
+			double activeFraction() const override { return lastActiveFraction; }
+
+		private:
+
+			// One tile of one world, its state is stored with its halo
+			struct Tile {
+				int world;
+				int x;					// Position of the interior in the world
+				int y;
+				int width;				// Size of the interior, smaller than the tile side on the right and bottom edges
+				int height;
+				size_t stateOffset;			// [depth][height + 2 * radius][width + 2 * radius] in tileStates
+				size_t intermediateOffset;	// [depth][height][width] in tileIntermediates
+			};
+
+			ThreadPool threadPool;
+
+			int width;
+			int height;
+
+			int depth;
+			int batch;
+
+			int kernelRadius;
+			int kernelSize;
+
+			BoundaryMode boundary;
+			ColorPass colorPass;
+			Precision precision;
+
+			// Cells drawn by each pixel of the output, the tiles are only colored in place with one pixel per cell
+			DisplayFootprint footprint;
+
+			LeniaParameters leniaParameters;
+			std::vector<GrowthParameters> worldGrowth;
+			std::vector<float> kernel;
+			DirectRowKernel rowKernel;
+
+			// Tiles of all the worlds, [world][tileRow][tileColumn]
+			int tileSide;
+			int tileColumns;
+			int tileRows;
+			std::vector<Tile> tiles;
+
+			std::vector<float> tileStates;
+			std::vector<float> tileIntermediates;
+
+			// Sparse stepping, the tiles are all stepped with an epsilon of 0
+			float activityEpsilon;
+			int activityReach;					// Tiles within the kernel radius of a tile, on each side
+			std::vector<float> tileActivity;	// Largest value or change of the last update, infinite until the next one
+			std::vector<int> activeTiles;		// Tiles stepped by the current step
+			std::vector<int> inactiveTiles;
+			std::vector<char> liveTiles;		// Scratch of the selection, [tileRow][tileColumn] of one world
+			std::vector<char> reachedTiles;
+			double lastActiveFraction = 1.0;
+
+			void init_tiles();
+			void init_kernel(const std::vector<KernelRing>& rings, std::vector<float>& target) const;
+			void check_world(int world) const;
+
+			const Tile& tile_at(int world, int x, int y) const;
+
+			// Copy between the tiles and [world][channel][height][width] host arrays
+			void gather_worlds(int firstWorld, int worldCount, float* h_state);
+			void scatter_world(int world, const float* h_state);
+
+			// Copy count cells of a world row into destination, reading the interiors of the tiles they belong to
+			// NOTE: x and y can be outside of the world, the boundary mode decides what is read there
+			void read_row(int world, int channel, int y, int x, int count, float* destination) const;
+
+			// Sparse stepping, a world only sleeps if its growth leaves empty cells under the epsilon
+			bool world_can_sleep(int world) const;
+			void mark_world_active(int world);
+			void select_active_tiles();
+
+			void exchange_halos();
+			void convolve_tile(const Tile& tile);
+			void update_tile(const Tile& tile, lve::Pixel* output);
+			void color_tile(const Tile& tile, lve::Pixel* output) const;
+			void color_inactive_tiles(lve::Pixel* output);
+			void color_view(lve::Pixel* output);
+	};
+
+	// Tile side whose working set (state with its halo, convolution output and kernels) fits in half of the L2 cache
+	// NOTE: The side is reduced for small worlds, so that every thread gets a few tiles
+	int defaultTileSize(const SimulationConfig& config, int threadCount);
+}
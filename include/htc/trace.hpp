@@ -0,0 +1,62 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+
+// Events kept per thread, the oldest ones are overwritten
+#define TRACE_BUFFER_EVENTS 16384
+
+// Time the enclosing scope under name, a string literal, when the tracing is enabled
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SCOPE(name) htc::TraceScope TRACE_CONCAT(traceScope, __LINE__){name}
+
+
+namespace htc {
+
+	// Read by every scope, an event more or less around a change does not matter
+	extern std::atomic<bool> traceEnabled;
+
+	inline bool tracingEnabled() { return traceEnabled.load(std::memory_order_relaxed); }
+	void setTracingEnabled(bool enabled);
+
+	// Name of the calling thread in the trace, the threads without a name are numbered
+	// NOTE: Cheap enough to be called by every thread, even when the tracing is disabled
+	void setTraceThreadName(const std::string& name);
+
+	// Nanoseconds of a monotonic clock
+	int64_t traceClock();
+
+	// Append an event to the ring of the calling thread, allocated on its first event
+	void recordTraceEvent(const char* name, int64_t start, int64_t end);
+
+	// Write the events of all the threads as a Chrome trace (chrome://tracing, ui.perfetto.dev)
+	// NOTE: The rings are read while the threads may still write to them, an event written meanwhile can be torn
+	void writeTrace(const std::string& path);
+
+	// This class times its own lifetime, it only reads the clock when the tracing is enabled
+	// NOTE: The name must outlive the trace, only the pointer is stored
+	class TraceScope {
+
+		public:
+
+			explicit TraceScope(const char* name) : name(name), start(tracingEnabled() ? traceClock() : -1) {}
+
+			~TraceScope() {
+				if (start >= 0 && tracingEnabled()) {
+					recordTraceEvent(name, start, traceClock());
+				}
+			}
+
+			// Not copyable or movable
+			TraceScope(const TraceScope&) = delete;
+			TraceScope& operator=(const TraceScope&) = delete;
+
+		private:
+
+			const char* name;
+			int64_t start;
+	};
+}
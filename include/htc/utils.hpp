@@ -1,10 +1,11 @@
 #pragma once
 
 #include <hip/hip_runtime.h>
+#include <hipfft/hipfft.h>
 #include <miopen/miopen.h>
 #include <iostream>
 
-// Macros for handling HIP and MIOpen errors
+// Macros for handling HIP, hipFFT and MIOpen errors
 
 #define CHECK_HIP_ERROR(status) \
     if (status != hipSuccess) { \
@@ -16,4 +17,10 @@
     if (status != miopenStatusSuccess) { \
         std::cerr << "MIOpen Error: " << status << " at line " << __LINE__ << " in " << __FILE__ << std::endl; \
         exit(1); \
+    }
+
+#define CHECK_HIPFFT_ERROR(status) \
+    if (status != HIPFFT_SUCCESS) { \
+        std::cerr << "hipFFT Error: " << status << " at line " << __LINE__ << " in " << __FILE__ << std::endl; \
+        exit(1); \
     }
\ No newline at end of file
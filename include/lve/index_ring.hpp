@@ -0,0 +1,64 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+
+namespace lve {
+
+	// Time spent by the consumer of a ring waiting for an index
+	struct RingWaitStatistics {
+		uint64_t waits = 0;			// Pops that found the ring empty
+		uint64_t parks = 0;			// Waits that outlasted the spinning and slept
+		double waitSeconds = 0.0;
+	};
+
+	// This class hands buffer indices from one producer thread to one consumer thread
+	// push and tryPop are lock-free, pop spins for a while then parks on a condition variable
+	// NOTE: The mutex is only taken by a parked consumer and by the producer that wakes it up
+	// NOTE: The ring never holds more than capacity indices, the buffers they name are owned by someone else
+	class LveIndexRing {
+		public:
+
+			LveIndexRing(uint32_t capacity, uint32_t spinCount);
+
+			// Not copyable or movable
+			LveIndexRing(const LveIndexRing&) = delete;
+			LveIndexRing& operator=(const LveIndexRing&) = delete;
+
+			// Producer side
+			void push(uint32_t index);
+
+			// Consumer side, pop returns false once the ring is closed
+			bool tryPop(uint32_t& index);
+			bool pop(uint32_t& index);
+
+			// Wake up a parked consumer for good, the following pops fail once the ring is empty
+			void close();
+
+			// Only meaningful once the consumer is done, the counters are not synchronized
+			const RingWaitStatistics& statistics() const { return waitStatistics; }
+
+		private:
+
+			std::vector<uint32_t> slots;
+			uint32_t spinCount;
+
+			// Monotonic counters, the slot of a counter is its value modulo the capacity
+			// NOTE: On separate cache lines, so that both threads do not write to the same line
+			alignas(64) std::atomic<uint64_t> head{0};
+			alignas(64) std::atomic<uint64_t> tail{0};
+
+			alignas(64) std::atomic<bool> parked{false};
+			std::atomic<bool> closed{false};
+			std::mutex parkMutex;
+			std::condition_variable parkCondition;
+
+			RingWaitStatistics waitStatistics;
+
+			void wake_consumer();
+	};
+}
\ No newline at end of file
@@ -1,12 +1,18 @@
 # pragma once
 
 #include "lve/device.hpp"
+#include "lve/index_ring.hpp"
 #include "lve/utils.hpp"
 
-#include <condition_variable>
+#include "htc/latency_histogram.hpp"
+
+#include <atomic>
+#include <cstdint>
 #include <vector>
-#include <mutex>
-#include <deque>
+
+
+// Iterations spent polling for a buffer before sleeping, 0 sleeps right away
+#define VERTEX_BUFFER_SPIN_COUNT 4096
 
 
 namespace lve {
@@ -14,13 +20,19 @@ namespace lve {
 	// This class is used to contain the vertices of subsequent frames
 	// and to manage the synchronization between the rendering and the updating of the vertices
 	// it allows the redering pipeline and the frame generation pipeline to work in parallel
-	// NOTE: There are as many vertex buffers as there are frames in the swap chain
+	// NOTE: A command buffer is recorded for each pair of swap chain image and vertex buffer
 	// NOTE: This way we don't need to rebind the vertex buffers every frame
 	// NOTE: This may however lead to a slight increase in memory usage
+	// NOTE: The indices are handed over through two lock-free rings, a pass only sleeps after spinning for spinCount iterations
+	// NOTE: In the mailbox mode, a new frame replaces the one waiting to be shown, so the generation pass never waits for the render pass
+	// NOTE: A buffer that is no longer shown is only written again once the frames that read it are complete
+	// NOTE: The positions never change, they live in a single device local buffer bound next to the colors of each frame
 	class LveMultipleVertexBuffer {
 		public:
 
-			LveMultipleVertexBuffer(LveDevice& device, std::vector<VkBuffer> vertexBuffers, uint32_t vertexBufferCount, uint32_t vertexCount);
+			// Without positions, only the synchronization is used and nothing is drawn from the vertex buffers
+			LveMultipleVertexBuffer(LveDevice& device, std::vector<VkBuffer> vertexBuffers, uint32_t vertexBufferCount, const std::vector<Position>& positions,
+									bool mailbox, uint32_t spinCount = VERTEX_BUFFER_SPIN_COUNT);
 			~LveMultipleVertexBuffer();
 
 			// Not copyable or movable
@@ -30,34 +42,67 @@ namespace lve {
 			void bind(VkCommandBuffer commandBuffer, int vertexBufferIndex);
 			void draw(VkCommandBuffer commandBuffer);
 
-			// Called at the beginning of a render or generation pass
-			uint32_t getAvailableReadBuffer();
-			uint32_t getAvailableWriteBuffer();
+			// Called at the beginning of a render or generation pass, return false once exit has been called
+			// NOTE: In the mailbox mode, the read buffer is the last one shown if there is no new frame, and false is returned until the first frame
+			bool getAvailableReadBuffer(uint32_t& bufferIndex);
+			bool getAvailableWriteBuffer(uint32_t& bufferIndex);
 
-			// Called at the end of a render or generation pass
+			// Called at the end of a generation pass
 			void setReadBufferAvailable(uint32_t bufferIndex);
-			void setWriteBufferAvailable(uint32_t bufferIndex);
+
+			// Called by the render pass once all the frames but the last framesInFlight ones are complete
+			void releaseCompletedBuffers(uint32_t framesInFlight);
 
 			void exit();
 
-		private:
+			// Time the generation pass waited for a write buffer, and the render pass for a read buffer
+			// NOTE: Only meaningful once both passes are stopped
+			const RingWaitStatistics& producerWaitStatistics() const { return writeBuffers.statistics(); }
+			const RingWaitStatistics& consumerWaitStatistics() const { return readBuffers.statistics(); }
+			uint64_t droppedFrames() const { return droppedFrameCount.load(); }
+
+			// Time between the end of a generation pass and the render pass that picks its buffer up
+			// NOTE: A frame replaced in the mailbox is never picked up, so it is not counted
+			htc::LatencyHistogram& handoffLatency() { return handoffHistogram; }
 
-			bool running = true;
+			void printStatistics() const;
+
+		private:
 
 			LveDevice& lveDevice;
 
-			// Vertex buffers
+			// Vertex buffers, the colors of each frame
 			std::vector<VkBuffer> vertexBuffers;
 			uint32_t vertexBufferCount;
 			uint32_t vertexCount;
 
-			// Synchonization
-			std::mutex readMutex;
-			std::condition_variable readCondition;
-			std::deque<uint32_t> availableReadBuffers;
+			// Static positions, shared by all the frames
+			VkBuffer positionBuffer = VK_NULL_HANDLE;
+			VkDeviceMemory positionBufferMemory = VK_NULL_HANDLE;
+
+			// Synchronization, the generation pass produces read buffers and the render pass produces write buffers
+			LveIndexRing readBuffers;
+			LveIndexRing writeBuffers;
+
+			// Mailbox mode, the newest frame not shown yet (NO_BUFFER if none)
+			static constexpr uint32_t NO_BUFFER = UINT32_MAX;
+			bool mailbox;
+			std::atomic<uint32_t> latestFrame{NO_BUFFER};
+			std::atomic<uint64_t> droppedFrameCount{0};
+
+			// Owned by the generation pass, a replaced frame that can be written again right away
+			uint32_t spareBuffer = NO_BUFFER;
+
+			// Written by the generation pass before handing a buffer over, read by the render pass once it has it
+			std::vector<int64_t> publishTimes;
+			htc::LatencyHistogram handoffHistogram{"handoff"};
+
+			// Owned by the render pass, the buffer shown and the ones that may still be read by frames in flight
+			uint32_t shownBuffer = NO_BUFFER;
+			std::vector<uint32_t> retiredBuffers;
+			std::vector<uint64_t> lastFrameUsed;
+			uint64_t frameCount = 0;
 
-			std::mutex writeMutex;
-			std::condition_variable writeCondition;
-			std::deque<uint32_t> availableWriteBuffers;
+			void createPositionBuffer(const std::vector<Position>& positions);
 	};
 }
\ No newline at end of file
@@ -9,7 +9,10 @@
 namespace lve {
 
 	// Pipeline configuration struct
+	// NOTE: The vertex input defaults to the Vertex layout, a pipeline without vertex buffer leaves it empty
 	struct PipelineConfigInfo {
+		std::vector<VkVertexInputBindingDescription> bindingDescriptions;
+		std::vector<VkVertexInputAttributeDescription> attributeDescriptions;
 		VkViewport viewport;
 		VkRect2D scissor;
 		VkPipelineInputAssemblyStateCreateInfo inputAssemblyInfo;
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstdint>
+
+
+// NOTE: Kept apart from lve/utils.hpp, so that the simulation can be built without the Vulkan headers
+namespace lve {
+
+	// Position of a cell in the points display mode, computed once at startup
+	struct Position {
+		float x;
+		float y;
+	};
+
+	// Color of a cell written by the simulation at every frame, read as RGBA8 by the shaders
+	struct Pixel {
+		uint8_t r;
+		uint8_t g;
+		uint8_t b;
+		uint8_t a;
+	};
+}
\ No newline at end of file
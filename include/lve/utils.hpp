@@ -3,6 +3,9 @@
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 
+#include "lve/pixel.hpp"
+#include "htc/latency_histogram.hpp"
+
 #include <vulkan/vulkan.h>
 #include <chrono>
 #include <vector>
@@ -10,38 +13,31 @@
 
 namespace lve {
 
-	// Define the vertex format
-	struct Position {
-		float x;
-		float y;
-	};
-
-	struct Color {
-		float r;
-		float g;
-		float b;
-	};
-
+	// Define the vertex format of the points display mode: a static Position stream [0] and a Pixel stream [1]
+	// NOTE: Only the 4 bytes of the colors are written per frame, instead of the 20 bytes of an interleaved vertex
 	struct Vertex {
-		Position position;
-		Color color;
-
 		static std::vector<VkVertexInputBindingDescription> getBindingDescriptions();
 		static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions();
 	};
 
-	// This class is used to keep track of the frames per second
-	// and print the FPS to the console at a given interval
-	class FPSCounter {
+	// This class is used to keep track of the frames per second and of the latency histograms
+	// and print them to the console at a given interval, with the percentiles of the last interval
+	// NOTE: The histograms are recorded by other threads, the reporter only reads them
+	class LatencyReporter {
 		public:
 
-			FPSCounter(int printInterval);
+			// An interval of 0 only prints the summaries since the start, when printTotals is called
+			LatencyReporter(int printInterval, std::vector<htc::LatencyHistogram*> histograms);
+
+			// Called once per frame by the render loop
 			void update();
+			void printTotals() const;
 
 		private:
 
 			int frameCount = 0;
-			const int fpsInterval;
-			std::chrono::time_point<std::chrono::high_resolution_clock> lastFPSUpdate;
+			const int printInterval;
+			std::vector<htc::LatencyHistogram*> histograms;
+			std::chrono::time_point<std::chrono::steady_clock> lastPrint;
 	};
 }
\ No newline at end of file
@@ -24,9 +24,18 @@ namespace lve {
 
 			void createWindowSurface(VkInstance instance, VkSurfaceKHR* surface);
 
+			// Cursor, buttons and keys are read from the GLFW window, only the scroll needs a callback
+			GLFWwindow* getGLFWwindow() const { return window; }
+
+			// Vertical scroll accumulated since the previous call, in wheel steps
+			double takeScrollOffset();
+
 		private:
 			void initWindow();
 
+			static void scrollCallback(GLFWwindow* window, double xOffset, double yOffset);
+			double scrollOffset = 0.0;
+
 			const int width;
 			const int height;
 
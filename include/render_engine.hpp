@@ -8,24 +8,41 @@
 #include "lve/utils.hpp"
 
 #include "hip_tracer.hpp"
+#include "htc/simulation_backend.hpp"
 
 #include <memory>
 #include <vector>
 #include <thread>
 #include <atomic>
+#include <cstdint>
 
 #define WINDOW_WIDTH 512
 #define WINDOW_HEIGHT 512
 
 #define WINDOW_NAME "Lenia with Vulkan and HIP"
 
-#define FPS_COUNTER_DISPLAY_INTERVAL 5
+// Zoom factor of one step of the mouse wheel
+#define DISPLAY_ZOOM_STEP 1.25f
+
+// Largest zoom, in pixels per cell
+#define DISPLAY_MAX_CELL_PIXELS 16
 
 
 namespace lve {
 
+	// Push constants of the texture display mode, see shaders/texture.frag
+	struct DisplayPushConstants {
+		int32_t frameWidth;
+		int32_t frameHeight;
+		float viewportWidth;
+		float viewportHeight;
+	};
+
 	// This class is responsible for managing all ressources and operations related to Vulkan
 	// it gets its data from a HipTracer object and renders it to the screen
+	// NOTE: In the texture display mode, the frame buffers are bound as storage buffers and drawn with a single
+	// fullscreen triangle, in the points display mode they are bound as vertex buffers and drawn as points
+	// NOTE: The frames have one pixel per pixel of the window, the world is reduced to them by the simulation
 	class RenderEngine {
 
 		public:
@@ -33,7 +50,7 @@ namespace lve {
 			static constexpr int WIDTH = WINDOW_WIDTH;
 			static constexpr int HEIGHT = WINDOW_HEIGHT;
 
-			RenderEngine();
+			RenderEngine(htc::SimulationConfig simulationConfig = {});
 			~RenderEngine();
 
 			// Not copyable or movable
@@ -43,11 +60,13 @@ namespace lve {
 			void run();
 
 		private:
-			void createVertexSupplier();
+			void createVertexSupplier(htc::SimulationConfig simulationConfig);
+			void createDescriptorSets();
 			void createPipelineLayout();
 			void createPipeline();
 			void createCommandBuffers();
 			void updateVertexData();
+			void updateDisplayView();
 			void drawFrame();
 
 			void startUpdateThread();
@@ -61,13 +80,35 @@ namespace lve {
 			VkPipelineLayout pipelineLayout;
 			std::vector<VkCommandBuffer> commandBuffers;
 			std::unique_ptr<LveMultipleVertexBuffer> lveMultipleVertexBuffer;
+			uint32_t vertexBuffersCount;
+
+			// One descriptor set per frame buffer, only used in the texture display mode
+			htc::DisplayMode display;
+			VkDescriptorSetLayout descriptorSetLayout = VK_NULL_HANDLE;
+			VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+			std::vector<VkDescriptorSet> descriptorSets;
+
+			// Part of the world shown in the window, moved with the mouse and handed to the simulation thread
+			htc::DisplayView displayView;
+			float maxZoom;
+			bool dragging = false;
+			double dragX;
+			double dragY;
 
 			// Main loop
 			std::thread updateThread;
 			std::atomic<bool> running{true};
 
-			// FPS counter
-			FPSCounter fpsCounter{FPS_COUNTER_DISPLAY_INTERVAL};
+			// Latencies: the simulation steps of a frame, and the time between two presented frames
+			// NOTE: The handoff latency between both is kept by the vertex buffers
+			htc::LatencyHistogram stepLatency{"step"};
+			htc::LatencyHistogram presentLatency{"present"};
+			int64_t lastPresent = -1;
+			std::unique_ptr<LatencyReporter> latencyReporter;
+			std::string latencyReportPath;
+
+			// Chrome trace written at the end of run (empty: disabled)
+			std::string tracePath;
 
 			// HipTracer object
 			std::unique_ptr<htc::HipTracer> vertexSupplier;
@@ -1,2 +1,4 @@
 glslc simple_shader.vert -o simple_shader.vert.spv
-glslc simple_shader.frag -o simple_shader.frag.spv
\ No newline at end of file
+glslc simple_shader.frag -o simple_shader.frag.spv
+glslc fullscreen.vert -o fullscreen.vert.spv
+glslc texture.frag -o texture.frag.spv
\ No newline at end of file
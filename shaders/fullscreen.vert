@@ -0,0 +1,7 @@
+#version 450
+
+// One triangle that covers the whole screen, the cells are looked up by the fragment shader
+void main () {
+	vec2 position = vec2((gl_VertexIndex << 1) & 2, gl_VertexIndex & 2);
+	gl_Position = vec4(position * 2.0 - 1.0, 0.0, 1.0);
+}
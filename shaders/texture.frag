@@ -0,0 +1,20 @@
+#version 450
+
+// Packed RGBA8 colors of the frame written by the simulation, one uint per pixel
+layout ( set = 0, binding = 0 ) readonly buffer Frame {
+	uint pixels[];
+};
+
+layout ( push_constant ) uniform Display {
+	ivec2 frameSize;
+	vec2 viewportSize;
+} display;
+
+layout ( location = 0 ) out vec4 outColor;
+
+void main() {
+	// Nearest pixel of the frame, the frame is stretched over the whole viewport
+	ivec2 pixel = min(ivec2(gl_FragCoord.xy * vec2(display.frameSize) / display.viewportSize), display.frameSize - 1);
+
+	outColor = vec4(unpackUnorm4x8(pixels[pixel.y * display.frameSize.x + pixel.x]).rgb, 1.0);
+}
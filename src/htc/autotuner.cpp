@@ -0,0 +1,182 @@
+#include "htc/autotuner.hpp"
+#include "htc/precision.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+
+namespace htc {
+
+	TuningDatabase::TuningDatabase(const std::string& path) : databasePath(path) {
+		if (!databasePath.empty()) {
+			load();
+		}
+	}
+
+	void TuningDatabase::load() {
+		// A missing database is an empty one
+		std::ifstream file{databasePath};
+		if (!file.is_open()) {
+			return;
+		}
+
+		std::string line;
+		while (std::getline(file, line)) {
+			size_t separator = line.find(" = ");
+			if (line.empty() || line[0] == '#' || separator == std::string::npos) {
+				continue;
+			}
+			entries[line.substr(0, separator)] = line.substr(separator + 3);
+		}
+	}
+
+	void TuningDatabase::save() const {
+		std::filesystem::path path{databasePath};
+		if (path.has_parent_path()) {
+			std::filesystem::create_directories(path.parent_path());
+		}
+
+		// Written next to the database then renamed, so that a reader never sees half a file
+		std::string temporaryPath = databasePath + ".tmp";
+		{
+			std::ofstream file{temporaryPath};
+			if (!file.is_open()) {
+				throw std::runtime_error("failed to open file: " + temporaryPath);
+			}
+
+			file << "# LeniAMD tuning database, delete it to tune again\n";
+			for (const auto& [key, value] : entries) {
+				file << key << " = " << value << "\n";
+			}
+			if (!file) {
+				throw std::runtime_error("failed to write file: " + temporaryPath);
+			}
+		}
+		std::filesystem::rename(temporaryPath, path);
+	}
+
+	bool TuningDatabase::find(const std::string& key, std::string& value) const {
+		auto entry = entries.find(key);
+		if (entry == entries.end()) {
+			return false;
+		}
+		value = entry->second;
+		return true;
+	}
+
+	void TuningDatabase::store(const std::string& key, const std::string& value) {
+		entries[key] = value;
+		if (databasePath.empty()) {
+			return;
+		}
+
+		// A database that cannot be written only costs a search to the next run
+		try {
+			save();
+		}
+		catch (const std::exception& e) {
+			fprintf(stderr, "The tuning database is not saved: %s\n", e.what());
+		}
+	}
+
+	std::string tuningDatabasePath(const SimulationConfig& config) {
+		if (config.tuning == TuningMode::Off) {
+			return "";
+		}
+		if (!config.tuningDatabasePath.empty()) {
+			return config.tuningDatabasePath;
+		}
+
+		// Same lookup as the XDG base directories
+		const char* cacheHome = std::getenv("XDG_CACHE_HOME");
+		if (cacheHome != nullptr && cacheHome[0] != '\0') {
+			return (std::filesystem::path(cacheHome) / TUNING_DATABASE_NAME).string();
+		}
+		const char* home = std::getenv("HOME");
+		if (home != nullptr && home[0] != '\0') {
+			return (std::filesystem::path(home) / ".cache" / TUNING_DATABASE_NAME).string();
+		}
+		return "";
+	}
+
+	std::string tuningKey(const std::string& scope, const SimulationConfig& config, int threadCount) {
+		char key[256];
+		snprintf(key, sizeof(key), "%s %dx%dx%d r%d %s b%d %s e%g t%d", scope.c_str(),
+			config.width, config.height, config.channels, config.kernelRadius, precisionName(config.precision), config.batchSize,
+			boundaryModeName(config.boundary), config.separableTolerance, threadCount);
+		return key;
+	}
+
+	double timeCandidate(const std::function<void()>& run, int warmupRuns, int timedRuns) {
+		for (int i = 0; i < warmupRuns; i++) {
+			run();
+		}
+
+		std::vector<double> times(std::max(1, timedRuns));
+		for (double& time : times) {
+			auto start = std::chrono::steady_clock::now();
+			run();
+			std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+			time = elapsed.count();
+		}
+
+		// The median ignores a run slowed down by the rest of the system
+		std::nth_element(times.begin(), times.begin() + times.size() / 2, times.end());
+		return times[times.size() / 2];
+	}
+
+	ConvolutionMode resolveConvolutionMode(const SimulationConfig& config, const std::string& scope, int threadCount,
+											const std::function<double(ConvolutionMode)>& timeMode) {
+		if (config.convolution != ConvolutionMode::Auto) {
+			return config.convolution;
+		}
+
+		TuningDatabase database{tuningDatabasePath(config)};
+		std::string key = tuningKey("convolution " + scope, config, threadCount);
+
+		// A stored winner skips the search, an entry that no longer parses is searched again
+		std::string stored;
+		if (config.tuning == TuningMode::Cached && database.find(key, stored)) {
+			try {
+				ConvolutionMode mode = parseConvolutionMode(stored);
+				if (mode != ConvolutionMode::Auto) {
+					printf("Autotuner: %s convolution, from %s\n", convolutionModeName(mode), database.path().c_str());
+					return mode;
+				}
+			}
+			catch (const std::invalid_argument&) {}
+		}
+
+		ConvolutionMode bestMode = ConvolutionMode::Direct;
+		double bestTime = std::numeric_limits<double>::infinity();
+		for (ConvolutionMode mode : {ConvolutionMode::Direct, ConvolutionMode::Fft, ConvolutionMode::Separable}) {
+			try {
+				double time = timeMode(mode);
+				printf("Autotuner: %-9s %10.3f ms\n", convolutionModeName(mode), time * 1e3);
+
+				if (time < bestTime) {
+					bestTime = time;
+					bestMode = mode;
+				}
+			}
+			catch (const std::invalid_argument& e) {
+				printf("Autotuner: %-9s unsupported (%s)\n", convolutionModeName(mode), e.what());
+			}
+		}
+
+		if (bestTime == std::numeric_limits<double>::infinity()) {
+			throw std::runtime_error("No convolution mode is supported for " + key);
+		}
+
+		printf("Autotuner: %s convolution\n", convolutionModeName(bestMode));
+		database.store(key, convolutionModeName(bestMode));
+		return bestMode;
+	}
+}
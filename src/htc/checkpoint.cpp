@@ -0,0 +1,226 @@
+#include "htc/checkpoint.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+#define CHECKPOINT_MAGIC "LENIACKP"
+
+
+namespace htc {
+
+	static_assert(sizeof(CheckpointHeader) == 80, "The checkpoint header layout changed, bump CHECKPOINT_VERSION");
+	static_assert(sizeof(CheckpointRing) == 20, "The checkpoint ring layout changed, bump CHECKPOINT_VERSION");
+	static_assert(sizeof(GrowthParameters) == 3 * sizeof(float), "GrowthParameters is stored as 3 floats");
+
+	// Size of the header, the rings and the growth parameters of every world
+	static size_t metadataSize(size_t ringCount, size_t batch) {
+		return sizeof(CheckpointHeader) + ringCount * sizeof(CheckpointRing) + batch * sizeof(GrowthParameters);
+	}
+
+	std::vector<char> encodeCheckpointMetadata(const SimulationBackend& simulation, uint64_t step) {
+		const LeniaParameters& parameters = simulation.parameters();
+		int batch = simulation.batchSize();
+		size_t worldSize = static_cast<size_t>(simulation.worldWidth()) * simulation.worldHeight() * simulation.channels();
+
+		CheckpointHeader header = {};
+		std::memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic));
+		header.version = CHECKPOINT_VERSION;
+		header.headerSize = sizeof(CheckpointHeader);
+		header.width = simulation.worldWidth();
+		header.height = simulation.worldHeight();
+		header.channels = simulation.channels();
+		header.batch = batch;
+		header.kernelRadius = simulation.radius();
+		header.ringCount = static_cast<uint32_t>(parameters.rings.size());
+		header.step = step;
+		header.dataOffset = (metadataSize(parameters.rings.size(), batch) + CHECKPOINT_ALIGNMENT - 1) / CHECKPOINT_ALIGNMENT * CHECKPOINT_ALIGNMENT;
+		header.dataSize = batch * worldSize * sizeof(float);
+		header.growth = parameters.growth;
+		header.boundary = static_cast<uint8_t>(simulation.boundaryMode());
+		header.precision = static_cast<uint8_t>(simulation.storagePrecision());
+
+		// The padding stays filled with zeros
+		std::vector<char> metadata(header.dataOffset, 0);
+		char* cursor = metadata.data();
+
+		std::memcpy(cursor, &header, sizeof(header));
+		cursor += sizeof(header);
+
+		for (const KernelRing& ring : parameters.rings) {
+			CheckpointRing stored = {ring.source, ring.target, ring.mu, ring.sigma, ring.weight};
+			std::memcpy(cursor, &stored, sizeof(stored));
+			cursor += sizeof(stored);
+		}
+		for (int world = 0; world < batch; world++) {
+			std::memcpy(cursor, &simulation.growth(world), sizeof(GrowthParameters));
+			cursor += sizeof(GrowthParameters);
+		}
+
+		return metadata;
+	}
+
+	void saveCheckpoint(const std::string& path, SimulationBackend& simulation, uint64_t step) {
+		int batch = simulation.batchSize();
+
+		std::string temporaryPath = path + ".tmp";
+		std::ofstream file{temporaryPath, std::ios::binary | std::ios::trunc};
+		if (!file.is_open()) {
+			throw std::runtime_error("failed to open file: " + temporaryPath);
+		}
+
+		std::vector<char> metadata = encodeCheckpointMetadata(simulation, step);
+		file.write(metadata.data(), metadata.size());
+
+		// One world at a time, or one part of a world for the backends that stream their state, never all of the batch
+		for (int world = 0; world < batch; world++) {
+			simulation.streamWorldState(world, [&](const float* values, size_t count) {
+				file.write(reinterpret_cast<const char*>(values), count * sizeof(float));
+			});
+		}
+
+		file.close();
+		if (!file) {
+			std::remove(temporaryPath.c_str());
+			throw std::runtime_error("failed to write file: " + temporaryPath);
+		}
+
+		if (std::rename(temporaryPath.c_str(), path.c_str()) != 0) {
+			std::remove(temporaryPath.c_str());
+			throw std::runtime_error("failed to replace file: " + path);
+		}
+	}
+
+	MappedCheckpoint::MappedCheckpoint(const std::string& path) : path(path) {
+		int descriptor = open(path.c_str(), O_RDONLY);
+		if (descriptor < 0) {
+			throw std::runtime_error("failed to open file: " + path);
+		}
+
+		struct stat status;
+		if (fstat(descriptor, &status) != 0 || status.st_size < static_cast<off_t>(sizeof(CheckpointHeader))) {
+			close(descriptor);
+			throw std::runtime_error(path + ": not a checkpoint");
+		}
+		mappingSize = static_cast<size_t>(status.st_size);
+
+		// The mapping keeps the file alive, the descriptor is not needed anymore
+		mapping = mmap(nullptr, mappingSize, PROT_READ, MAP_PRIVATE, descriptor, 0);
+		close(descriptor);
+		if (mapping == MAP_FAILED) {
+			mapping = nullptr;
+			throw std::runtime_error("failed to map file: " + path);
+		}
+
+		try {
+			validate();
+		}
+		catch (...) {
+			munmap(mapping, mappingSize);
+			throw;
+		}
+
+		// The state is read once from start to end, the kernel can start reading it ahead
+		char* state = static_cast<char*>(mapping) + header().dataOffset;
+		madvise(state, header().dataSize, MADV_SEQUENTIAL);
+		madvise(state, header().dataSize, MADV_WILLNEED);
+	}
+
+	MappedCheckpoint::~MappedCheckpoint() {
+		if (mapping != nullptr) {
+			munmap(mapping, mappingSize);
+		}
+	}
+
+	void MappedCheckpoint::validate() const {
+		const CheckpointHeader& stored = header();
+
+		if (std::memcmp(stored.magic, CHECKPOINT_MAGIC, sizeof(stored.magic)) != 0) {
+			throw std::runtime_error(path + ": not a checkpoint");
+		}
+		if (stored.version != CHECKPOINT_VERSION || stored.headerSize != sizeof(CheckpointHeader)) {
+			throw std::runtime_error(path + ": unsupported checkpoint version " + std::to_string(stored.version));
+		}
+		if (stored.width == 0 || stored.height == 0 || stored.channels == 0 || stored.batch == 0 || stored.kernelRadius == 0) {
+			throw std::runtime_error(path + ": empty world");
+		}
+		if (stored.boundary > static_cast<uint8_t>(BoundaryMode::Periodic) || stored.precision > static_cast<uint8_t>(Precision::BFloat16)) {
+			throw std::runtime_error(path + ": unknown boundary mode or precision");
+		}
+
+		uint64_t expectedSize = static_cast<uint64_t>(stored.batch) * stored.channels * stored.width * stored.height * sizeof(float);
+		if (stored.dataSize != expectedSize || stored.dataOffset % CHECKPOINT_ALIGNMENT != 0
+			|| stored.dataOffset < metadataSize(stored.ringCount, stored.batch)
+			|| stored.dataOffset + stored.dataSize > mappingSize) {
+			throw std::runtime_error(path + ": truncated or corrupted checkpoint");
+		}
+	}
+
+	LeniaParameters MappedCheckpoint::parameters() const {
+		const CheckpointRing* rings = reinterpret_cast<const CheckpointRing*>(static_cast<const char*>(mapping) + sizeof(CheckpointHeader));
+
+		LeniaParameters result;
+		result.growth = header().growth;
+		for (uint32_t i = 0; i < header().ringCount; i++) {
+			result.rings.push_back({rings[i].source, rings[i].target, rings[i].mu, rings[i].sigma, rings[i].weight});
+		}
+		return result;
+	}
+
+	const GrowthParameters& MappedCheckpoint::worldGrowth(int world) const {
+		if (world < 0 || world >= static_cast<int>(header().batch)) {
+			throw std::out_of_range("World " + std::to_string(world) + " in a checkpoint of " + std::to_string(header().batch));
+		}
+
+		const char* growth = static_cast<const char*>(mapping) + sizeof(CheckpointHeader) + header().ringCount * sizeof(CheckpointRing);
+		return reinterpret_cast<const GrowthParameters*>(growth)[world];
+	}
+
+	const float* MappedCheckpoint::worldState(int world) const {
+		if (world < 0 || world >= static_cast<int>(header().batch)) {
+			throw std::out_of_range("World " + std::to_string(world) + " in a checkpoint of " + std::to_string(header().batch));
+		}
+
+		size_t worldSize = static_cast<size_t>(header().channels) * header().width * header().height;
+		const float* state = reinterpret_cast<const float*>(static_cast<const char*>(mapping) + header().dataOffset);
+		return state + world * worldSize;
+	}
+
+	SimulationConfig checkpointConfig(const MappedCheckpoint& checkpoint, const SimulationConfig& config) {
+		SimulationConfig result = config;
+		result.width = checkpoint.header().width;
+		result.height = checkpoint.header().height;
+		result.channels = checkpoint.header().channels;
+		result.batchSize = checkpoint.header().batch;
+		result.kernelRadius = checkpoint.header().kernelRadius;
+		result.boundary = static_cast<BoundaryMode>(checkpoint.header().boundary);
+		result.precision = static_cast<Precision>(checkpoint.header().precision);
+		return result;
+	}
+
+	uint64_t restoreCheckpoint(const MappedCheckpoint& checkpoint, SimulationBackend& simulation) {
+		const CheckpointHeader& header = checkpoint.header();
+
+		if (simulation.worldWidth() != static_cast<int>(header.width) || simulation.worldHeight() != static_cast<int>(header.height)
+			|| simulation.channels() != static_cast<int>(header.channels) || simulation.batchSize() != static_cast<int>(header.batch)) {
+			throw std::invalid_argument("The simulation doesn't have the shape of the checkpoint, create it from checkpointConfig");
+		}
+
+		// setParameters resets the growth of every world, so the per world ones come after it
+		simulation.setParameters(checkpoint.parameters());
+
+		for (int world = 0; world < static_cast<int>(header.batch); world++) {
+			simulation.setWorldGrowth(world, checkpoint.worldGrowth(world));
+			simulation.writeWorldState(world, checkpoint.worldState(world));
+		}
+
+		return header.step;
+	}
+}
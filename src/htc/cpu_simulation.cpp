@@ -0,0 +1,305 @@
+#include "htc/cpu_simulation.hpp"
+#include "htc/autotuner.hpp"
+#include "htc/parameters.hpp"
+#include "htc/display.hpp"
+#include "htc/trace.hpp"
+
+#include "lve/pixel.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+
+namespace htc {
+
+	CpuSimulation::CpuSimulation(const SimulationConfig& config) :
+		threadPool(config.threadCount), width(config.width), height(config.height), depth(config.channels),
+		batch(config.batchSize), kernelRadius(config.kernelRadius), boundary(config.boundary), colorPass(config.colorPass), precision(config.precision),
+		footprint(computeDisplayFootprint({}, config.width, config.height)), leniaParameters(initialParameters(config)) {
+
+		// Allocate memory for the state and intermediate arrays
+		state.resize(static_cast<size_t>(batch) * width * height * depth);
+		intermediate.resize(static_cast<size_t>(batch) * width * height * depth);
+
+		worldGrowth.assign(batch, leniaParameters.growth);
+
+		// Build the same kernels as the GPU backend
+		int kernelSize = 2 * kernelRadius + 1;
+		std::vector<float> kernel(depth * depth * kernelSize * kernelSize);
+		initKernelTensor(depth, kernelRadius, leniaParameters.rings, kernel.data());
+
+		SimulationConfig convolutionConfig = config;
+		convolutionConfig.convolution = choose_convolution(config, kernel.data());
+		convolution = createHostConvolution(convolutionConfig, depth, kernel.data(), threadPool);
+
+		// Initialize Lenia with random values
+		init_state(initialSeed(config));
+	}
+
+	ConvolutionMode CpuSimulation::choose_convolution(const SimulationConfig& config, const float* kernel) {
+		// Each candidate convolves one random world, the worlds of a batch are convolved one after the other
+		size_t worldSize = static_cast<size_t>(width) * height * depth;
+		std::vector<float> input;
+		std::vector<float> output;
+
+		return resolveConvolutionMode(config, name(), threadPool.size(), [&](ConvolutionMode mode) {
+			if (input.empty()) {
+				input.resize(worldSize);
+				output.resize(worldSize);
+				fillRandomState(1, worldSize, input.data());
+			}
+
+			SimulationConfig candidateConfig = config;
+			candidateConfig.convolution = mode;
+			std::unique_ptr<HostConvolution> candidate = createHostConvolution(candidateConfig, depth, kernel, threadPool);
+
+			return timeCandidate([&]() { candidate->run(input.data(), output.data()); });
+		});
+	}
+
+	void CpuSimulation::init_state(uint64_t seed) {
+		// Each world has its own seed
+		for (int world = 0; world < batch; world++) {
+			resetWorld(world, seed + world);
+		}
+	}
+
+	void CpuSimulation::check_world(int world) const {
+		if (world < 0 || world >= batch) {
+			throw std::out_of_range("World " + std::to_string(world) + " in a batch of " + std::to_string(batch));
+		}
+	}
+
+	void CpuSimulation::resetWorld(int world, uint64_t seed) {
+		check_world(world);
+
+		size_t worldSize = static_cast<size_t>(width) * height * depth;
+		fillRandomState(seed, worldSize, &state[world * worldSize]);
+		roundToPrecision(precision, &state[world * worldSize], worldSize);
+	}
+
+	void CpuSimulation::runConvolution() {
+		TRACE_SCOPE("convolution");
+
+		// The engine works on one world at a time, each of them is split across the pool
+		size_t worldSize = static_cast<size_t>(width) * height * depth;
+		for (int world = 0; world < batch; world++) {
+			convolution->run(&state[world * worldSize], &intermediate[world * worldSize]);
+		}
+
+		// The convolution accumulates in fp32, only its output is stored with the reduced precision
+		if (precision != Precision::Float32) {
+			threadPool.parallelFor(batch * depth * height, [&](int begin, int end) {
+				roundToPrecision(precision, &intermediate[static_cast<size_t>(begin) * width], static_cast<size_t>(end - begin) * width);
+			});
+		}
+	}
+
+	void CpuSimulation::setParameters(const LeniaParameters& parameters) {
+		// Build the new kernels first, so that invalid parameters leave the simulation unchanged
+		int kernelSize = 2 * kernelRadius + 1;
+		std::vector<float> kernel(depth * depth * kernelSize * kernelSize);
+		initKernelTensor(depth, kernelRadius, parameters.rings, kernel.data());
+
+		convolution->setKernel(kernel.data());
+		leniaParameters = parameters;
+		worldGrowth.assign(batch, parameters.growth);
+	}
+
+	void CpuSimulation::setWorldGrowth(int world, const GrowthParameters& growth) {
+		check_world(world);
+		worldGrowth[world] = growth;
+	}
+
+	const GrowthParameters& CpuSimulation::growth(int world) const {
+		check_world(world);
+		return worldGrowth[world];
+	}
+
+	void CpuSimulation::update_worlds(int firstWorld) {
+		int worldRows = depth * height;
+
+		// Host equivalent of updateKernel, each task updates rows of a single world
+		threadPool.parallelFor((batch - firstWorld) * worldRows, [&](int begin, int end) {
+			for (int row = begin; row < end; row++) {
+				const GrowthParameters& growth = worldGrowth[firstWorld + row / worldRows];
+				size_t offset = (static_cast<size_t>(firstWorld) * worldRows + row) * width;
+
+				float* stateRow = &state[offset];
+				const float* intermediateRow = &intermediate[offset];
+
+				for (int x = 0; x < width; x++) {
+					float normalized = (intermediateRow[x] - growth.mu) / growth.sigma;
+					float t = expf(-normalized * normalized);
+
+					stateRow[x] = (1 - growth.timeStep) * stateRow[x] + growth.timeStep * t;
+				}
+				roundToPrecision(precision, stateRow, width);
+			}
+		});
+	}
+
+	void CpuSimulation::runUpdate() {
+		TRACE_SCOPE("update");
+
+		update_worlds(0);
+	}
+
+	void CpuSimulation::color_view(lve::Pixel* output) {
+		size_t planeSize = static_cast<size_t>(width) * height;
+
+		// Each task reduces whole rows of pixels, the cells are read in place
+		threadPool.parallelFor(footprint.height, [&](int begin, int end) {
+			colorViewRows(footprint, depth, begin, end, output, [&](int z, int y, int x, int) {
+				return &state[z * planeSize + static_cast<size_t>(y) * width + x];
+			});
+		});
+	}
+
+	void CpuSimulation::setDisplayView(const DisplayView& view) {
+		footprint = computeDisplayFootprint(view, width, height);
+	}
+
+	void CpuSimulation::runColor(lve::Pixel* output) {
+		TRACE_SCOPE("color");
+
+		if (!footprint.direct) {
+			color_view(output);
+			return;
+		}
+
+		// Host equivalent of colorKernel, the missing channels are black
+		const float* stateR = depth > 0 ? &state[0 * width * height] : nullptr;
+		const float* stateG = depth > 1 ? &state[1 * width * height] : nullptr;
+		const float* stateB = depth > 2 ? &state[2 * width * height] : nullptr;
+
+		threadPool.parallelFor(height, [&](int begin, int end) {
+			for (int y = begin; y < end; y++) {
+				for (int x = 0; x < width; x++) {
+					int idx = y * width + x;
+
+					writeCell(output[idx],
+						stateR != nullptr ? stateR[idx] : 0.0f,
+						stateG != nullptr ? stateG[idx] : 0.0f,
+						stateB != nullptr ? stateB[idx] : 0.0f);
+				}
+			}
+		});
+	}
+
+	void CpuSimulation::runUpdateColor(lve::Pixel* output) {
+		TRACE_SCOPE("update+color");
+
+		// The pixels of a view cover several cells, they are colored once all of them are updated
+		if (!footprint.direct) {
+			update_worlds(0);
+			color_view(output);
+			return;
+		}
+
+		float mu = worldGrowth[0].mu;
+		float sigma = worldGrowth[0].sigma;
+		float alpha = worldGrowth[0].timeStep;
+
+		// Host equivalent of updateColorKernel, only the first world is colored
+		// NOTE: Each row is updated one channel after the other, the row of cells stays in cache meanwhile
+		threadPool.parallelFor(height, [&](int begin, int end) {
+			for (int y = begin; y < end; y++) {
+				lve::Pixel* outputRow = output + y * width;
+
+				for (int z = 0; z < depth; z++) {
+					int offset = z * width * height + y * width;
+					float* stateRow = &state[offset];
+					const float* intermediateRow = &intermediate[offset];
+
+					for (int x = 0; x < width; x++) {
+						float normalized = (intermediateRow[x] - mu) / sigma;
+						float t = expf(-normalized * normalized);
+
+						float value = (1 - alpha) * stateRow[x] + alpha * t;
+						roundToPrecision(precision, &value, 1);
+						stateRow[x] = value;
+
+						if (z == 0) {
+							// The missing channels are black
+							writeCell(outputRow[x], value, 0.0f, 0.0f);
+						}
+						else if (z < 3) {
+							writeChannel(outputRow[x], z, value);
+						}
+					}
+				}
+			}
+		});
+
+		if (batch > 1) {
+			update_worlds(1);
+		}
+	}
+
+	void CpuSimulation::step(lve::Pixel* output) {
+		TRACE_SCOPE("step");
+
+		runConvolution();
+
+		if (output == nullptr) {
+			runUpdate();
+		}
+		else if (colorPass == ColorPass::Fused && footprint.direct) {
+			runUpdateColor(output);
+		}
+		else {
+			runUpdate();
+			runColor(output);
+		}
+	}
+
+	void CpuSimulation::readState(float* h_state) {
+		std::copy(state.begin(), state.end(), h_state);
+	}
+
+	void CpuSimulation::readWorldState(int world, float* h_state) {
+		check_world(world);
+
+		size_t worldSize = static_cast<size_t>(width) * height * depth;
+		std::copy(state.begin() + world * worldSize, state.begin() + (world + 1) * worldSize, h_state);
+	}
+
+	void CpuSimulation::writeWorldState(int world, const float* h_state) {
+		check_world(world);
+
+		size_t worldSize = static_cast<size_t>(width) * height * depth;
+		std::copy(h_state, h_state + worldSize, state.begin() + world * worldSize);
+		roundToPrecision(precision, &state[world * worldSize], worldSize);
+	}
+
+	std::vector<WorldMetrics> CpuSimulation::readMetrics() {
+		std::vector<WorldMetrics> metrics(batch);
+		for (WorldMetrics& world : metrics) {
+			world.mass.resize(depth);
+			world.maximum.resize(depth);
+		}
+
+		// One task per plane, the sums are accumulated in double precision
+		size_t planeSize = static_cast<size_t>(width) * height;
+		threadPool.parallelFor(batch * depth, [&](int begin, int end) {
+			for (int plane = begin; plane < end; plane++) {
+				const float* values = &state[plane * planeSize];
+
+				double mass = 0.0;
+				float maximum = 0.0f;
+				for (size_t i = 0; i < planeSize; i++) {
+					mass += values[i];
+					maximum = std::max(maximum, values[i]);
+				}
+
+				metrics[plane / depth].mass[plane % depth] = static_cast<float>(mass);
+				metrics[plane / depth].maximum[plane % depth] = maximum;
+			}
+		});
+
+		return metrics;
+	}
+}
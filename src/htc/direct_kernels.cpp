@@ -0,0 +1,128 @@
+#include "htc/direct_kernels.hpp"
+
+#include <algorithm>
+#include <array>
+#include <utility>
+
+
+// (radius, channels) pairs of the compile-time specialised direct convolutions, the only list is the one of CMake
+#ifndef LENIA_KERNEL_SHAPES
+#error "LENIA_KERNEL_SHAPES must list the specialised (radius, channels) pairs, it is set by CMakeLists.txt"
+#endif
+
+// Cells of a row accumulated together by the specialised convolutions, their sums stay in registers across all the taps
+#define DIRECT_BLOCK_WIDTH 16
+
+// The unrolled taps are larger than the inlining limits, they are only fast once inlined in the loops over the cells
+#define DIRECT_INLINE __attribute__((always_inline)) inline
+
+
+namespace htc {
+
+	void convolveDirectRow(const float* kernel, const float* padded, int paddedWidth, int paddedHeight,
+							int width, int depth, int radius, int target, int y, float* outputRow) {
+		int kernelSize = 2 * radius + 1;
+		std::fill(outputRow, outputRow + width, 0.0f);
+
+		for (int source = 0; source < depth; source++) {
+			const float* weights = &kernel[(target * depth + source) * kernelSize * kernelSize];
+
+			for (int ky = 0; ky < kernelSize; ky++) {
+				const float* inputRow = &padded[(static_cast<size_t>(source) * paddedHeight + y + ky) * paddedWidth];
+
+				// Accumulate the shifted input row
+				for (int kx = 0; kx < kernelSize; kx++) {
+					float weight = weights[ky * kernelSize + kx];
+					const float* shifted = inputRow + kx;
+
+					for (int x = 0; x < width; x++) {
+						outputRow[x] += weight * shifted[x];
+					}
+				}
+			}
+		}
+	}
+
+	// One tap of a kernel row for a block of cells
+	template <int Block>
+	static DIRECT_INLINE void accumulateTap(float weight, const float* input, float* sums) {
+		for (int i = 0; i < Block; i++) {
+			sums[i] += weight * input[i];
+		}
+	}
+
+	// All the taps of a kernel row, unrolled at compile time
+	// NOTE: The comma fold evaluates the taps from left to right, in the order of the generic loop
+	template <int Block, size_t... Taps>
+	static DIRECT_INLINE void accumulateKernelRow(const float* weights, const float* input, float* sums, std::index_sequence<Taps...>) {
+		(accumulateTap<Block>(weights[Taps], input + Taps, sums), ...);
+	}
+
+	template <int Radius, int Channels, int Block>
+	static DIRECT_INLINE void convolveBlock(const float* kernel, const float* padded, size_t planeSize, int paddedWidth,
+										int target, int y, int x, float* output) {
+		constexpr int kernelSize = 2 * Radius + 1;
+		float sums[Block] = {};
+
+		for (int source = 0; source < Channels; source++) {
+			const float* weights = &kernel[(target * Channels + source) * kernelSize * kernelSize];
+			const float* input = &padded[source * planeSize + static_cast<size_t>(y) * paddedWidth + x];
+
+			for (int ky = 0; ky < kernelSize; ky++) {
+				accumulateKernelRow<Block>(&weights[ky * kernelSize], &input[static_cast<size_t>(ky) * paddedWidth], sums,
+					std::make_index_sequence<kernelSize>{});
+			}
+		}
+
+		std::copy(sums, sums + Block, output);
+	}
+
+	// Same sums as convolveDirectRow, with the tap loops unrolled and each block of cells summed in registers
+	template <int Radius, int Channels>
+	static void convolveSpecializedRow(const float* kernel, const float* padded, int paddedWidth, int paddedHeight,
+										int width, int, int, int target, int y, float* outputRow) {
+		size_t planeSize = static_cast<size_t>(paddedHeight) * paddedWidth;
+
+		int x = 0;
+		for (; x + DIRECT_BLOCK_WIDTH <= width; x += DIRECT_BLOCK_WIDTH) {
+			convolveBlock<Radius, Channels, DIRECT_BLOCK_WIDTH>(kernel, padded, planeSize, paddedWidth, target, y, x, &outputRow[x]);
+		}
+		for (; x < width; x++) {
+			convolveBlock<Radius, Channels, 1>(kernel, padded, planeSize, paddedWidth, target, y, x, &outputRow[x]);
+		}
+	}
+
+	// Flat list of the specialised shapes, radius then channels
+	static constexpr int kernelShapes[] = { LENIA_KERNEL_SHAPES };
+	static constexpr size_t kernelShapeCount = sizeof(kernelShapes) / sizeof(kernelShapes[0]) / 2;
+	static_assert(sizeof(kernelShapes) / sizeof(kernelShapes[0]) % 2 == 0, "LENIA_KERNEL_SHAPES must hold (radius, channels) pairs");
+
+	struct DirectKernelEntry {
+		int radius;
+		int channels;
+		DirectRowKernel kernel;
+	};
+
+	template <size_t... Index>
+	static constexpr std::array<DirectKernelEntry, sizeof...(Index)> makeDirectKernelTable(std::index_sequence<Index...>) {
+		return {{ {kernelShapes[2 * Index], kernelShapes[2 * Index + 1],
+			&convolveSpecializedRow<kernelShapes[2 * Index], kernelShapes[2 * Index + 1]>}... }};
+	}
+
+	// Dispatch table of the instantiated shapes
+	static constexpr std::array<DirectKernelEntry, kernelShapeCount> directKernelTable =
+		makeDirectKernelTable(std::make_index_sequence<kernelShapeCount>{});
+
+	DirectRowKernel selectDirectRowKernel(int radius, int channels) {
+		for (const DirectKernelEntry& entry : directKernelTable) {
+			if (entry.radius == radius && entry.channels == channels) {
+				return entry.kernel;
+			}
+		}
+		return &convolveDirectRow;
+	}
+
+	bool isSpecializedKernelShape(int radius, int channels) {
+		return selectDirectRowKernel(radius, channels) != &convolveDirectRow;
+	}
+}
@@ -0,0 +1,63 @@
+#include "htc/display.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+
+namespace htc {
+
+	// Cells covered by each of count pixels along one axis of a view
+	static std::vector<int> viewRanges(int count, int cells, float center, float zoom) {
+		double visible = cells / static_cast<double>(zoom);
+		double origin = center * static_cast<double>(cells) - visible / 2.0;
+		double cellsPerPixel = visible / count;
+
+		std::vector<int> ranges(2 * count);
+		for (int i = 0; i < count; i++) {
+			// A pixel smaller than a cell still covers the cell it falls into
+			int begin = std::clamp(static_cast<int>(std::floor(origin + i * cellsPerPixel)), 0, cells - 1);
+			int end = std::clamp(static_cast<int>(std::floor(origin + (i + 1) * cellsPerPixel)), begin + 1, cells);
+
+			ranges[2 * i] = begin;
+			ranges[2 * i + 1] = end;
+		}
+		return ranges;
+	}
+
+	void clampDisplayView(DisplayView& view) {
+		view.zoom = std::max(view.zoom, 1.0f);
+
+		float halfSpan = 0.5f / view.zoom;
+		view.centerX = std::clamp(view.centerX, halfSpan, 1.0f - halfSpan);
+		view.centerY = std::clamp(view.centerY, halfSpan, 1.0f - halfSpan);
+	}
+
+	DisplayFootprint computeDisplayFootprint(const DisplayView& view, int worldWidth, int worldHeight) {
+		DisplayView clamped = view;
+		clamped.width = view.width > 0 ? view.width : worldWidth;
+		clamped.height = view.height > 0 ? view.height : worldHeight;
+		clampDisplayView(clamped);
+
+		if (clamped.width < 1 || clamped.height < 1) {
+			throw std::invalid_argument("The display view needs at least one pixel");
+		}
+
+		DisplayFootprint footprint;
+		footprint.width = clamped.width;
+		footprint.height = clamped.height;
+		footprint.filter = clamped.filter;
+		footprint.columns = viewRanges(clamped.width, worldWidth, clamped.centerX, clamped.zoom);
+		footprint.rows = viewRanges(clamped.height, worldHeight, clamped.centerY, clamped.zoom);
+
+		// Any filter gives the cell itself when each pixel covers exactly one cell
+		footprint.direct = clamped.width == worldWidth && clamped.height == worldHeight;
+		for (int x = 0; footprint.direct && x < clamped.width; x++) {
+			footprint.direct = footprint.columns[2 * x] == x && footprint.columns[2 * x + 1] == x + 1;
+		}
+		for (int y = 0; footprint.direct && y < clamped.height; y++) {
+			footprint.direct = footprint.rows[2 * y] == y && footprint.rows[2 * y + 1] == y + 1;
+		}
+		return footprint;
+	}
+}
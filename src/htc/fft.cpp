@@ -0,0 +1,315 @@
+#include "htc/fft.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+// Number of columns gathered together by the column pass
+#define FFT_COLUMN_BLOCK 8
+
+
+namespace htc {
+
+	namespace {
+
+		inline Complex add(Complex a, Complex b) { return {a.re + b.re, a.im + b.im}; }
+		inline Complex sub(Complex a, Complex b) { return {a.re - b.re, a.im - b.im}; }
+		inline Complex mul(Complex a, Complex b) { return {a.re * b.re - a.im * b.im, a.re * b.im + a.im * b.re}; }
+		inline Complex conj(Complex a) { return {a.re, -a.im}; }
+		inline Complex scale(Complex a, float s) { return {a.re * s, a.im * s}; }
+
+		// Multiply by -i (forward) or +i (inverse)
+		inline Complex rotate(Complex a, bool inverse) { return inverse ? Complex{-a.im, a.re} : Complex{a.im, -a.re}; }
+
+		inline Complex polar(double angle) { return {static_cast<float>(std::cos(angle)), static_cast<float>(std::sin(angle))}; }
+	}
+
+	FftPlan::FftPlan(int size) : n(size) {
+		if (size <= 0) {
+			throw std::invalid_argument("FFT size must be positive");
+		}
+
+		// Factorize the size, radix 4 first since it has the cheapest butterfly
+		std::vector<int> radices;
+		int remaining = size;
+		while (remaining % 4 == 0) {
+			radices.push_back(4);
+			remaining /= 4;
+		}
+		for (int radix = 2; remaining > 1; radix++) {
+			while (remaining % radix == 0) {
+				radices.push_back(radix);
+				remaining /= radix;
+			}
+		}
+
+		// Precompute the twiddle factors of each stage
+		int length = size;
+		int stride = 1;
+		for (int radix : radices) {
+			Stage stage;
+			stage.radix = radix;
+			stage.m = length / radix;
+			stage.stride = stride;
+			stage.twiddles.resize(stage.m * radix);
+
+			for (int j = 0; j < stage.m; j++) {
+				for (int u = 0; u < radix; u++) {
+					stage.twiddles[j * radix + u] = polar(-2.0 * M_PI * j * u / length);
+				}
+			}
+
+			stage.roots.resize(radix);
+			for (int k = 0; k < radix; k++) {
+				stage.roots[k] = polar(-2.0 * M_PI * k / radix);
+			}
+
+			stages.push_back(std::move(stage));
+			length /= radix;
+			stride *= radix;
+		}
+	}
+
+	int FftPlan::nextFastSize(int minimumSize) {
+		for (int size = std::max(1, minimumSize); ; size++) {
+			int remaining = size;
+			for (int factor : {2, 3, 5}) {
+				while (remaining % factor == 0) {
+					remaining /= factor;
+				}
+			}
+			if (remaining == 1) {
+				return size;
+			}
+		}
+	}
+
+	void FftPlan::forward(Complex* data, Complex* scratch) const {
+		transform(data, scratch, false);
+	}
+
+	void FftPlan::inverse(Complex* data, Complex* scratch) const {
+		transform(data, scratch, true);
+	}
+
+	void FftPlan::transform(Complex* data, Complex* scratch, bool inverse) const {
+		Complex* src = data;
+		Complex* dst = scratch;
+
+		const float sin3 = inverse ? 0.86602540378f : -0.86602540378f;
+
+		for (const Stage& stage : stages) {
+			int p = stage.radix;
+			int m = stage.m;
+			int s = stage.stride;
+
+			for (int j = 0; j < m; j++) {
+				const Complex* w = &stage.twiddles[j * p];
+
+				for (int q = 0; q < s; q++) {
+					// Butterfly on the p values spaced by m sub-sequences
+					Complex b[5];
+
+					if (p == 2) {
+						Complex a0 = src[q + s * (j + 0 * m)];
+						Complex a1 = src[q + s * (j + 1 * m)];
+						b[0] = add(a0, a1);
+						b[1] = sub(a0, a1);
+					}
+					else if (p == 3) {
+						Complex a0 = src[q + s * (j + 0 * m)];
+						Complex a1 = src[q + s * (j + 1 * m)];
+						Complex a2 = src[q + s * (j + 2 * m)];
+						Complex t1 = add(a1, a2);
+						Complex t2 = sub(a0, scale(t1, 0.5f));
+						Complex t3 = scale(sub(a1, a2), sin3);
+						b[0] = add(a0, t1);
+						b[1] = {t2.re - t3.im, t2.im + t3.re};
+						b[2] = {t2.re + t3.im, t2.im - t3.re};
+					}
+					else if (p == 4) {
+						Complex a0 = src[q + s * (j + 0 * m)];
+						Complex a1 = src[q + s * (j + 1 * m)];
+						Complex a2 = src[q + s * (j + 2 * m)];
+						Complex a3 = src[q + s * (j + 3 * m)];
+						Complex t0 = add(a0, a2);
+						Complex t1 = sub(a0, a2);
+						Complex t2 = add(a1, a3);
+						Complex t3 = rotate(sub(a1, a3), inverse);
+						b[0] = add(t0, t2);
+						b[1] = add(t1, t3);
+						b[2] = sub(t0, t2);
+						b[3] = sub(t1, t3);
+					}
+					else {
+						// Generic DFT for the remaining prime factors
+						for (int u = 0; u < p; u++) {
+							Complex sum = {0.0f, 0.0f};
+							for (int r = 0; r < p; r++) {
+								Complex root = stage.roots[(r * u) % p];
+								sum = add(sum, mul(src[q + s * (j + r * m)], inverse ? conj(root) : root));
+							}
+							dst[q + s * (p * j + u)] = mul(sum, inverse ? conj(w[u]) : w[u]);
+						}
+						continue;
+					}
+
+					// Apply the twiddle factors and store the outputs contiguously
+					dst[q + s * (p * j + 0)] = b[0];
+					for (int u = 1; u < p; u++) {
+						dst[q + s * (p * j + u)] = mul(b[u], inverse ? conj(w[u]) : w[u]);
+					}
+				}
+			}
+
+			std::swap(src, dst);
+		}
+
+		// The result ends up in the buffer written by the last stage
+		if (src != data) {
+			std::memcpy(data, src, n * sizeof(Complex));
+		}
+	}
+
+	RealFft2d::RealFft2d(int width, int height) : rowPlan(width), columnPlan(height) {}
+
+	void RealFft2d::forward(const float* input, int inputWidth, int inputHeight, Complex* spectrum, ThreadPool& threadPool) const {
+		int n = width();
+		int halfWidth = spectrumWidth();
+
+		// Rows: two real rows are packed in one complex transform and separated afterward
+		int rowPairs = (height() + 1) / 2;
+		threadPool.parallelFor(rowPairs, [&](int begin, int end) {
+			std::vector<Complex> buffer(n);
+			std::vector<Complex> scratch(n);
+
+			for (int pair = begin; pair < end; pair++) {
+				int rowA = 2 * pair;
+				int rowB = 2 * pair + 1;
+
+				Complex* spectrumA = &spectrum[rowA * halfWidth];
+				Complex* spectrumB = rowB < height() ? &spectrum[rowB * halfWidth] : nullptr;
+
+				// Padding rows have an empty spectrum
+				if (rowA >= inputHeight) {
+					std::fill(spectrumA, spectrumA + halfWidth, Complex{0.0f, 0.0f});
+					if (spectrumB != nullptr) {
+						std::fill(spectrumB, spectrumB + halfWidth, Complex{0.0f, 0.0f});
+					}
+					continue;
+				}
+
+				const float* inputA = &input[rowA * inputWidth];
+				const float* inputB = rowB < inputHeight ? &input[rowB * inputWidth] : nullptr;
+
+				for (int x = 0; x < n; x++) {
+					bool inside = x < inputWidth;
+					buffer[x].re = inside ? inputA[x] : 0.0f;
+					buffer[x].im = inside && inputB != nullptr ? inputB[x] : 0.0f;
+				}
+
+				rowPlan.forward(buffer.data(), scratch.data());
+
+				// A[k] = (Z[k] + conj(Z[-k])) / 2 and B[k] = -i * (Z[k] - conj(Z[-k])) / 2
+				for (int k = 0; k < halfWidth; k++) {
+					Complex z = buffer[k];
+					Complex zm = conj(buffer[(n - k) % n]);
+					spectrumA[k] = scale(add(z, zm), 0.5f);
+					if (spectrumB != nullptr) {
+						Complex d = sub(z, zm);
+						spectrumB[k] = {0.5f * d.im, -0.5f * d.re};
+					}
+				}
+			}
+		});
+
+		transformColumns(spectrum, false, threadPool);
+	}
+
+	void RealFft2d::inverse(Complex* spectrum, float* output, int outputWidth, int outputHeight, ThreadPool& threadPool) const {
+		int n = width();
+		int halfWidth = spectrumWidth();
+
+		transformColumns(spectrum, true, threadPool);
+
+		// Rows: rebuild Z = A + iB from the two half spectra, the real and imaginary parts hold both rows
+		// NOTE: Only the rows that are kept are transformed
+		int rowPairs = (outputHeight + 1) / 2;
+		threadPool.parallelFor(rowPairs, [&](int begin, int end) {
+			std::vector<Complex> buffer(n);
+			std::vector<Complex> scratch(n);
+
+			for (int pair = begin; pair < end; pair++) {
+				int rowA = 2 * pair;
+				int rowB = 2 * pair + 1;
+
+				const Complex* spectrumA = &spectrum[rowA * halfWidth];
+				const Complex* spectrumB = rowB < height() ? &spectrum[rowB * halfWidth] : nullptr;
+
+				for (int k = 0; k < n; k++) {
+					// Hermitian symmetry gives the upper half of each row spectrum
+					bool lower = k < halfWidth;
+					Complex a = lower ? spectrumA[k] : conj(spectrumA[n - k]);
+					Complex b = {0.0f, 0.0f};
+					if (spectrumB != nullptr) {
+						b = lower ? spectrumB[k] : conj(spectrumB[n - k]);
+					}
+					buffer[k] = {a.re - b.im, a.im + b.re};
+				}
+
+				rowPlan.inverse(buffer.data(), scratch.data());
+
+				float* outputA = &output[rowA * outputWidth];
+				for (int x = 0; x < outputWidth; x++) {
+					outputA[x] = buffer[x].re;
+				}
+
+				if (rowB < outputHeight) {
+					float* outputB = &output[rowB * outputWidth];
+					for (int x = 0; x < outputWidth; x++) {
+						outputB[x] = buffer[x].im;
+					}
+				}
+			}
+		});
+	}
+
+	void RealFft2d::transformColumns(Complex* spectrum, bool inverse, ThreadPool& threadPool) const {
+		int m = height();
+		int halfWidth = spectrumWidth();
+
+		// Columns are gathered by blocks to make the strided accesses less painful
+		int blocks = (halfWidth + FFT_COLUMN_BLOCK - 1) / FFT_COLUMN_BLOCK;
+		threadPool.parallelFor(blocks, [&](int begin, int end) {
+			std::vector<Complex> columns(FFT_COLUMN_BLOCK * m);
+			std::vector<Complex> scratch(m);
+
+			for (int block = begin; block < end; block++) {
+				int firstColumn = block * FFT_COLUMN_BLOCK;
+				int columnCount = std::min(FFT_COLUMN_BLOCK, halfWidth - firstColumn);
+
+				for (int y = 0; y < m; y++) {
+					for (int c = 0; c < columnCount; c++) {
+						columns[c * m + y] = spectrum[y * halfWidth + firstColumn + c];
+					}
+				}
+
+				for (int c = 0; c < columnCount; c++) {
+					if (inverse) {
+						columnPlan.inverse(&columns[c * m], scratch.data());
+					}
+					else {
+						columnPlan.forward(&columns[c * m], scratch.data());
+					}
+				}
+
+				for (int y = 0; y < m; y++) {
+					for (int c = 0; c < columnCount; c++) {
+						spectrum[y * halfWidth + firstColumn + c] = columns[c * m + y];
+					}
+				}
+			}
+		});
+	}
+}
@@ -0,0 +1,99 @@
+#include "htc/fft_convolution.hpp"
+
+#include <algorithm>
+
+
+namespace htc {
+
+	int fftConvolutionSize(int size, int kernelRadius, BoundaryMode boundary) {
+		// A circular convolution of this size is exactly the periodic one
+		if (boundary == BoundaryMode::Periodic) {
+			return size;
+		}
+
+		// The radius cells past the edge must stay zero so that nothing wraps around
+		return FftPlan::nextFastSize(size + kernelRadius);
+	}
+
+	FftConvolution::FftConvolution(const SimulationConfig& config, int depth, const float* kernel, ThreadPool& threadPool) :
+		threadPool(threadPool), width(config.width), height(config.height), depth(depth), kernelRadius(config.kernelRadius),
+		fft(fftConvolutionSize(config.width, config.kernelRadius, config.boundary),
+			fftConvolutionSize(config.height, config.kernelRadius, config.boundary)) {
+
+		int spectrumSize = fft.spectrumSize();
+		kernelSpectra.resize(depth * depth * spectrumSize);
+		inputSpectra.resize(depth * spectrumSize);
+		outputSpectra.resize(depth * spectrumSize);
+
+		setKernel(kernel);
+	}
+
+	void FftConvolution::setKernel(const float* kernel) {
+		fillKernelSpectra(fft, depth, kernelRadius, kernel, kernelSpectra.data(), threadPool);
+	}
+
+	void fillKernelSpectra(const RealFft2d& fft, int depth, int kernelRadius, const float* kernel, Complex* kernelSpectra, ThreadPool& threadPool) {
+		int kernelSize = 2 * kernelRadius + 1;
+		int fftWidth = fft.width();
+		int fftHeight = fft.height();
+
+		// The normalization of the inverse transform is folded in the kernel spectra
+		float normalization = 1.0f / (static_cast<float>(fftWidth) * fftHeight);
+
+		std::vector<float> plane(fftWidth * fftHeight);
+
+		for (int pair = 0; pair < depth * depth; pair++) {
+			const float* weights = &kernel[pair * kernelSize * kernelSize];
+
+			// Correlation with the kernel is a convolution with the kernel mirrored around its center
+			// NOTE: Kernels larger than the world wrap around and add up, as they do on a torus
+			std::fill(plane.begin(), plane.end(), 0.0f);
+			for (int dy = -kernelRadius; dy <= kernelRadius; dy++) {
+				for (int dx = -kernelRadius; dx <= kernelRadius; dx++) {
+					int y = ((-dy % fftHeight) + fftHeight) % fftHeight;
+					int x = ((-dx % fftWidth) + fftWidth) % fftWidth;
+					plane[y * fftWidth + x] += normalization * weights[(dy + kernelRadius) * kernelSize + dx + kernelRadius];
+				}
+			}
+
+			fft.forward(plane.data(), fftWidth, fftHeight, &kernelSpectra[pair * fft.spectrumSize()], threadPool);
+		}
+	}
+
+	void FftConvolution::run(const float* input, float* output) {
+		int spectrumSize = fft.spectrumSize();
+
+		// Transform each source channel once
+		for (int source = 0; source < depth; source++) {
+			fft.forward(&input[source * width * height], width, height, &inputSpectra[source * spectrumSize], threadPool);
+		}
+
+		// Multiply by the kernel spectra and accumulate per target channel
+		threadPool.parallelFor(spectrumSize, [&](int begin, int end) {
+			for (int target = 0; target < depth; target++) {
+				Complex* accumulated = &outputSpectra[target * spectrumSize];
+
+				for (int i = begin; i < end; i++) {
+					accumulated[i] = {0.0f, 0.0f};
+				}
+
+				for (int source = 0; source < depth; source++) {
+					const Complex* kernelSpectrum = &kernelSpectra[(target * depth + source) * spectrumSize];
+					const Complex* inputSpectrum = &inputSpectra[source * spectrumSize];
+
+					for (int i = begin; i < end; i++) {
+						Complex k = kernelSpectrum[i];
+						Complex x = inputSpectrum[i];
+						accumulated[i].re += k.re * x.re - k.im * x.im;
+						accumulated[i].im += k.re * x.im + k.im * x.re;
+					}
+				}
+			}
+		});
+
+		// One inverse transform per target channel
+		for (int target = 0; target < depth; target++) {
+			fft.inverse(&outputSpectra[target * spectrumSize], &output[target * width * height], width, height, threadPool);
+		}
+	}
+}
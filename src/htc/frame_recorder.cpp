@@ -0,0 +1,304 @@
+#include "htc/frame_recorder.hpp"
+#include "htc/display.hpp"
+#include "htc/trace.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+#include <zlib.h>
+
+
+#define RECORDING_MAGIC "LENIAREC"
+
+
+namespace htc {
+
+	static_assert(sizeof(RecordingHeader) == 48, "The recording header layout changed, bump RECORDING_VERSION");
+	static_assert(sizeof(RecordingIndexEntry) == 16, "The recording index layout changed, bump RECORDING_VERSION");
+
+	void quantizeFrame(const lve::Pixel* frame, size_t count, uint8_t* rgb) {
+		// The colors are already quantized, only the alpha is dropped
+		for (size_t i = 0; i < count; i++) {
+			rgb[3 * i + 0] = frame[i].r;
+			rgb[3 * i + 1] = frame[i].g;
+			rgb[3 * i + 2] = frame[i].b;
+		}
+	}
+
+	void quantizeState(const float* state, int channels, int width, int height, uint8_t* rgb) {
+		size_t planeSize = static_cast<size_t>(width) * height;
+
+		// The missing channels are black
+		for (int c = 0; c < 3; c++) {
+			const float* plane = c < channels ? state + c * planeSize : nullptr;
+			for (size_t i = 0; i < planeSize; i++) {
+				rgb[3 * i + c] = plane != nullptr ? quantizeColor(plane[i]) : 0;
+			}
+		}
+	}
+
+	FrameRecorder::FrameRecorder(const std::string& path, int width, int height, int workerCount) :
+		path(path), width(width), height(height) {
+
+		if (width <= 0 || height <= 0 || workerCount < 1) {
+			throw std::invalid_argument("A recording needs a non empty frame and at least one worker");
+		}
+
+		file.open(path, std::ios::binary | std::ios::trunc);
+		if (!file.is_open()) {
+			throw std::runtime_error("failed to open file: " + path);
+		}
+
+		// The header is written again with the index when the recording is closed
+		write_header();
+		writeOffset = sizeof(RecordingHeader);
+
+		frameSize = static_cast<size_t>(width) * height * 3;
+		previous.assign(frameSize, 0);
+
+		// Two buffers per worker, so that the next frames can be encoded while the workers compress
+		for (int i = 0; i < 2 * workerCount; i++) {
+			auto frame = std::make_unique<Frame>();
+			frame->delta.resize(frameSize);
+			frame->compressed.resize(compressBound(static_cast<uLong>(frameSize)));
+			freeFrames.push_back(std::move(frame));
+		}
+
+		for (int i = 0; i < workerCount; i++) {
+			workers.emplace_back(&FrameRecorder::worker_loop, this);
+		}
+	}
+
+	FrameRecorder::~FrameRecorder() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			running = false;
+		}
+		queueCondition.notify_all();
+		for (std::thread& worker : workers) {
+			worker.join();
+		}
+
+		// The index follows the last frame, then the header points to it
+		file.seekp(static_cast<std::streamoff>(writeOffset));
+		file.write(reinterpret_cast<const char*>(index.data()), index.size() * sizeof(RecordingIndexEntry));
+		write_header();
+		file.close();
+
+		if (!file || writeFailed) {
+			fprintf(stderr, "Failed to write recording: %s\n", path.c_str());
+		}
+	}
+
+	bool FrameRecorder::recordFrame(const uint8_t* rgb) {
+		TRACE_SCOPE("record frame");
+
+		auto start = std::chrono::steady_clock::now();
+
+		std::unique_ptr<Frame> frame;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (freeFrames.empty()) {
+				counters.dropped++;
+				return false;
+			}
+			frame = std::move(freeFrames.back());
+			freeFrames.pop_back();
+		}
+
+		// Bytewise difference with the last recorded frame, wrapping around
+		// NOTE: Keyframes are encoded against a black frame, so that they can be decoded on their own
+		frame->index = frameCount++;
+		frame->keyframe = frame->index % RECORDING_KEYFRAME_INTERVAL == 0;
+
+		uint8_t* delta = frame->delta.data();
+		uint8_t* reference = previous.data();
+		uint8_t mask = frame->keyframe ? 0 : 0xFF;
+		for (size_t i = 0; i < frameSize; i++) {
+			delta[i] = static_cast<uint8_t>(rgb[i] - (reference[i] & mask));
+			reference[i] = rgb[i];
+		}
+
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			queue.push_back(std::move(frame));
+			pendingFrames++;
+			counters.recorded++;
+			counters.encodeSeconds += elapsed.count();
+		}
+		queueCondition.notify_one();
+
+		return true;
+	}
+
+	void FrameRecorder::flush() {
+		std::unique_lock<std::mutex> lock(mutex);
+		idleCondition.wait(lock, [this] { return pendingFrames == 0; });
+	}
+
+	RecordingStatistics FrameRecorder::statistics() const {
+		std::lock_guard<std::mutex> lock(mutex);
+		return counters;
+	}
+
+	void FrameRecorder::printStatistics() const {
+		RecordingStatistics stats = statistics();
+
+		double ratio = stats.compressedBytes > 0 ? static_cast<double>(stats.rawBytes) / stats.compressedBytes : 0.0;
+		double encodeMs = stats.recorded > 0 ? 1e3 * stats.encodeSeconds / stats.recorded : 0.0;
+		double compressMs = stats.recorded > 0 ? 1e3 * stats.compressSeconds / stats.recorded : 0.0;
+
+		printf("Recording: %llu frames, %llu dropped, compression ratio %.2f\n",
+			static_cast<unsigned long long>(stats.recorded), static_cast<unsigned long long>(stats.dropped), ratio);
+		printf("Recording: %.3f ms per encode, %.3f ms per compression\n", encodeMs, compressMs);
+	}
+
+	void FrameRecorder::worker_loop() {
+		setTraceThreadName("recorder");
+
+		while (true) {
+			std::unique_ptr<Frame> frame;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				queueCondition.wait(lock, [this] { return !queue.empty() || !running; });
+
+				// The queued frames are still compressed when stopping
+				if (queue.empty()) {
+					return;
+				}
+				frame = std::move(queue.front());
+				queue.pop_front();
+			}
+
+			auto start = std::chrono::steady_clock::now();
+
+			uLongf compressedSize = static_cast<uLongf>(frame->compressed.size());
+			int status = compress2(frame->compressed.data(), &compressedSize, frame->delta.data(), static_cast<uLong>(frameSize), RECORDING_COMPRESSION_LEVEL);
+
+			std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+			// The size is only used for the index, a failed compression is stored as an empty frame
+			if (status != Z_OK) {
+				compressedSize = 0;
+			}
+			uint32_t storedSize = static_cast<uint32_t>(compressedSize);
+			{
+				std::unique_lock<std::mutex> lock(writeMutex);
+				writeCondition.wait(lock, [this, &frame] { return nextFrameToWrite == frame->index; });
+
+				if (status != Z_OK) {
+					writeFailed = true;
+				}
+
+				file.write(reinterpret_cast<const char*>(frame->compressed.data()), storedSize);
+				if (!file) {
+					writeFailed = true;
+				}
+
+				index.push_back({writeOffset, storedSize, frame->keyframe ? 1u : 0u});
+				writeOffset += storedSize;
+				nextFrameToWrite++;
+			}
+			writeCondition.notify_all();
+
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				counters.rawBytes += frameSize;
+				counters.compressedBytes += storedSize;
+				counters.compressSeconds += elapsed.count();
+
+				freeFrames.push_back(std::move(frame));
+				pendingFrames--;
+			}
+			idleCondition.notify_all();
+		}
+	}
+
+	void FrameRecorder::write_header() {
+		RecordingHeader header = {};
+		std::memcpy(header.magic, RECORDING_MAGIC, sizeof(header.magic));
+		header.version = RECORDING_VERSION;
+		header.headerSize = sizeof(RecordingHeader);
+		header.width = width;
+		header.height = height;
+		header.keyframeInterval = RECORDING_KEYFRAME_INTERVAL;
+		header.frameCount = index.size();
+		header.indexOffset = writeOffset;
+
+		file.seekp(0);
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	}
+
+	FrameReader::FrameReader(const std::string& path) : path(path), file(path, std::ios::binary) {
+		if (!file.is_open()) {
+			throw std::runtime_error("failed to open file: " + path);
+		}
+
+		if (!file.read(reinterpret_cast<char*>(&recordingHeader), sizeof(recordingHeader))
+			|| std::memcmp(recordingHeader.magic, RECORDING_MAGIC, sizeof(recordingHeader.magic)) != 0) {
+			throw std::runtime_error(path + ": not a recording");
+		}
+		if (recordingHeader.version != RECORDING_VERSION || recordingHeader.headerSize != sizeof(RecordingHeader)) {
+			throw std::runtime_error(path + ": unsupported recording version " + std::to_string(recordingHeader.version));
+		}
+		if (recordingHeader.frameCount == 0) {
+			throw std::runtime_error(path + ": empty or unfinished recording");
+		}
+
+		index.resize(recordingHeader.frameCount);
+		file.seekg(static_cast<std::streamoff>(recordingHeader.indexOffset));
+		if (!file.read(reinterpret_cast<char*>(index.data()), index.size() * sizeof(RecordingIndexEntry)) || index[0].keyframe == 0) {
+			throw std::runtime_error(path + ": truncated or corrupted recording");
+		}
+
+		current.resize(static_cast<size_t>(recordingHeader.width) * recordingHeader.height * 3);
+	}
+
+	void FrameReader::readFrame(uint64_t frame, uint8_t* rgb) {
+		if (frame >= index.size()) {
+			throw std::out_of_range("Frame " + std::to_string(frame) + " in a recording of " + std::to_string(index.size()));
+		}
+
+		// Decoding resumes from the current frame if no keyframe is in between
+		uint64_t keyframe = frame;
+		while (index[keyframe].keyframe == 0) {
+			keyframe--;
+		}
+
+		uint64_t first = keyframe;
+		if (currentFrame >= static_cast<int64_t>(keyframe) && currentFrame <= static_cast<int64_t>(frame)) {
+			first = currentFrame + 1;
+		}
+
+		for (uint64_t i = first; i <= frame; i++) {
+			decode_frame(i);
+		}
+
+		std::memcpy(rgb, current.data(), current.size());
+	}
+
+	void FrameReader::decode_frame(uint64_t frame) {
+		const RecordingIndexEntry& entry = index[frame];
+
+		std::vector<uint8_t> compressed(entry.size);
+		file.seekg(static_cast<std::streamoff>(entry.offset));
+		if (!file.read(reinterpret_cast<char*>(compressed.data()), compressed.size())) {
+			throw std::runtime_error(path + ": truncated recording");
+		}
+
+		std::vector<uint8_t> delta(current.size());
+		uLongf deltaSize = static_cast<uLongf>(delta.size());
+		if (uncompress(delta.data(), &deltaSize, compressed.data(), entry.size) != Z_OK || deltaSize != delta.size()) {
+			throw std::runtime_error(path + ": corrupted frame " + std::to_string(frame));
+		}
+
+		for (size_t i = 0; i < current.size(); i++) {
+			current[i] = entry.keyframe != 0 ? delta[i] : static_cast<uint8_t>(current[i] + delta[i]);
+		}
+		currentFrame = frame;
+	}
+}
@@ -0,0 +1,165 @@
+#include "htc/host_convolution.hpp"
+#include "htc/fft_convolution.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+
+namespace htc {
+
+	// Copy the planes in the middle of planes padded by kernelRadius cells and fill the borders
+	static void padPlanes(ThreadPool& threadPool, const float* input, int width, int height, int depth,
+							int kernelRadius, BoundaryMode boundary, float* paddedInput) {
+		int paddedWidth = width + 2 * kernelRadius;
+		int paddedHeight = height + 2 * kernelRadius;
+
+		threadPool.parallelFor(depth * paddedHeight, [&](int begin, int end) {
+			for (int row = begin; row < end; row++) {
+				int channel = row / paddedHeight;
+				int sy = row % paddedHeight - kernelRadius;
+
+				float* padded = &paddedInput[row * paddedWidth];
+
+				if (boundary == BoundaryMode::Zero && (sy < 0 || sy >= height)) {
+					std::fill(padded, padded + paddedWidth, 0.0f);
+					continue;
+				}
+
+				sy = ((sy % height) + height) % height;
+				const float* source = &input[(channel * height + sy) * width];
+
+				for (int px = 0; px < paddedWidth; px++) {
+					int sx = px - kernelRadius;
+					if (sx >= 0 && sx < width) {
+						padded[px] = source[sx];
+					}
+					else if (boundary == BoundaryMode::Zero) {
+						padded[px] = 0.0f;
+					}
+					else {
+						padded[px] = source[((sx % width) + width) % width];
+					}
+				}
+			}
+		});
+	}
+
+	DirectConvolution::DirectConvolution(const SimulationConfig& config, int depth, const float* kernel, ThreadPool& threadPool) :
+		threadPool(threadPool), width(config.width), height(config.height), depth(depth),
+		kernelRadius(config.kernelRadius), boundary(config.boundary), rowKernel(selectDirectRowKernel(config.kernelRadius, depth)) {
+
+		setKernel(kernel);
+
+		paddedWidth = width + 2 * kernelRadius;
+		paddedHeight = height + 2 * kernelRadius;
+		paddedInput.resize(depth * paddedWidth * paddedHeight);
+	}
+
+	void DirectConvolution::setKernel(const float* kernel) {
+		int kernelSize = 2 * kernelRadius + 1;
+		this->kernel.assign(kernel, kernel + depth * depth * kernelSize * kernelSize);
+	}
+
+	void DirectConvolution::pad_input(const float* input) {
+		padPlanes(threadPool, input, width, height, depth, kernelRadius, boundary, paddedInput.data());
+	}
+
+	void DirectConvolution::run(const float* input, float* output) {
+		pad_input(input);
+
+		// Same semantics as the MIOpen convolution (cross-correlation)
+		// Each task computes one row of one target channel
+		threadPool.parallelFor(depth * height, [&](int begin, int end) {
+			for (int row = begin; row < end; row++) {
+				int target = row / height;
+				int y = row % height;
+
+				rowKernel(kernel.data(), paddedInput.data(), paddedWidth, paddedHeight, width, depth, kernelRadius,
+					target, y, &output[(target * height + y) * width]);
+			}
+		});
+	}
+
+	SeparableConvolution::SeparableConvolution(const SimulationConfig& config, int depth, const float* kernel, ThreadPool& threadPool) :
+		threadPool(threadPool), width(config.width), height(config.height), depth(depth),
+		kernelRadius(config.kernelRadius), boundary(config.boundary), tolerance(config.separableTolerance) {
+
+		setKernel(kernel);
+
+		paddedWidth = width + 2 * kernelRadius;
+		paddedHeight = height + 2 * kernelRadius;
+		paddedInput.resize(depth * paddedWidth * paddedHeight);
+		horizontalPass.resize(paddedHeight * width);
+	}
+
+	void SeparableConvolution::setKernel(const float* kernel) {
+		separableKernels = factorKernelTensor(depth, kernelRadius, kernel, tolerance);
+		printSeparableKernelReport(separableKernels, tolerance);
+	}
+
+	void SeparableConvolution::run(const float* input, float* output) {
+		padPlanes(threadPool, input, width, height, depth, kernelRadius, boundary, paddedInput.data());
+
+		int kernelSize = 2 * kernelRadius + 1;
+		std::fill(output, output + depth * width * height, 0.0f);
+
+		for (int target = 0; target < depth; target++) {
+			for (int source = 0; source < depth; source++) {
+				const SeparableKernel& pair = separableKernels.pairs[target * depth + source];
+
+				for (int component = 0; component < pair.rank; component++) {
+					const float* horizontal = &pair.horizontal[component * kernelSize];
+					const float* vertical = &pair.vertical[component * kernelSize];
+
+					// Horizontal pass over all the padded rows, the vertical pass needs the padding rows too
+					threadPool.parallelFor(paddedHeight, [&](int begin, int end) {
+						for (int row = begin; row < end; row++) {
+							const float* inputRow = &paddedInput[(source * paddedHeight + row) * paddedWidth];
+							float* passRow = &horizontalPass[row * width];
+							std::fill(passRow, passRow + width, 0.0f);
+
+							for (int kx = 0; kx < kernelSize; kx++) {
+								float weight = horizontal[kx];
+								const float* shifted = inputRow + kx;
+
+								for (int x = 0; x < width; x++) {
+									passRow[x] += weight * shifted[x];
+								}
+							}
+						}
+					});
+
+					// Vertical pass accumulated in the target channel
+					threadPool.parallelFor(height, [&](int begin, int end) {
+						for (int y = begin; y < end; y++) {
+							float* outputRow = &output[(target * height + y) * width];
+
+							for (int ky = 0; ky < kernelSize; ky++) {
+								float weight = vertical[ky];
+								const float* passRow = &horizontalPass[(y + ky) * width];
+
+								for (int x = 0; x < width; x++) {
+									outputRow[x] += weight * passRow[x];
+								}
+							}
+						}
+					});
+				}
+			}
+		}
+	}
+
+	std::unique_ptr<HostConvolution> createHostConvolution(const SimulationConfig& config, int depth, const float* kernel, ThreadPool& threadPool) {
+		if (config.convolution == ConvolutionMode::Auto) {
+			throw std::invalid_argument("The convolution mode must be resolved before creating the convolution");
+		}
+		if (config.convolution == ConvolutionMode::Fft) {
+			return std::make_unique<FftConvolution>(config, depth, kernel, threadPool);
+		}
+		if (config.convolution == ConvolutionMode::Separable) {
+			return std::make_unique<SeparableConvolution>(config, depth, kernel, threadPool);
+		}
+
+		return std::make_unique<DirectConvolution>(config, depth, kernel, threadPool);
+	}
+}
@@ -0,0 +1,184 @@
+#include "htc/latency_histogram.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <stdexcept>
+
+
+namespace htc {
+
+	static constexpr uint32_t SUB_BUCKETS = 1u << LATENCY_SUB_BUCKET_BITS;
+
+	// Raise target to value, the loop only retries while another thread raised it to something smaller
+	static void raiseMaximum(std::atomic<uint64_t>& target, uint64_t value) {
+		uint64_t current = target.load(std::memory_order_relaxed);
+		while (current < value && !target.compare_exchange_weak(current, value, std::memory_order_relaxed)) {}
+	}
+
+	LatencyHistogram::LatencyHistogram(const std::string& name) : histogramName(name) {
+		for (std::atomic<uint64_t>& bucket : buckets) {
+			bucket.store(0, std::memory_order_relaxed);
+		}
+	}
+
+	uint32_t LatencyHistogram::bucketIndex(uint64_t nanoseconds) {
+		if (nanoseconds < SUB_BUCKETS) {
+			return static_cast<uint32_t>(nanoseconds);
+		}
+
+		// The highest bit selects the power of two, the next LATENCY_SUB_BUCKET_BITS bits the sub-bucket
+		uint32_t exponent = 63 - __builtin_clzll(nanoseconds);
+		uint32_t shift = exponent - LATENCY_SUB_BUCKET_BITS;
+		return ((shift + 1) << LATENCY_SUB_BUCKET_BITS) + static_cast<uint32_t>((nanoseconds >> shift) - SUB_BUCKETS);
+	}
+
+	uint64_t LatencyHistogram::bucketLowerBound(uint32_t index) {
+		if (index < SUB_BUCKETS) {
+			return index;
+		}
+
+		uint32_t shift = (index >> LATENCY_SUB_BUCKET_BITS) - 1;
+		return static_cast<uint64_t>(SUB_BUCKETS + (index & (SUB_BUCKETS - 1))) << shift;
+	}
+
+	uint64_t LatencyHistogram::bucketUpperBound(uint32_t index) {
+		if (index < SUB_BUCKETS) {
+			return index + 1;
+		}
+
+		// The last bucket ends past the 64-bit range
+		uint64_t lower = bucketLowerBound(index);
+		uint64_t width = uint64_t{1} << ((index >> LATENCY_SUB_BUCKET_BITS) - 1);
+		return lower > std::numeric_limits<uint64_t>::max() - width ? std::numeric_limits<uint64_t>::max() : lower + width;
+	}
+
+	void LatencyHistogram::record(int64_t nanoseconds) {
+		uint64_t duration = nanoseconds > 0 ? static_cast<uint64_t>(nanoseconds) : 0;
+
+		buckets[bucketIndex(duration)].fetch_add(1, std::memory_order_relaxed);
+		total.fetch_add(duration, std::memory_order_relaxed);
+		raiseMaximum(maximum, duration);
+		raiseMaximum(intervalMaximum, duration);
+	}
+
+	void LatencyHistogram::read_counts(LatencyCounts& counts) const {
+		// The count is the sum of the buckets, so that the percentiles stay consistent with it
+		counts.count = 0;
+		for (uint32_t i = 0; i < LATENCY_BUCKET_COUNT; i++) {
+			counts.buckets[i] = buckets[i].load(std::memory_order_relaxed);
+			counts.count += counts.buckets[i];
+		}
+		counts.total = total.load(std::memory_order_relaxed);
+	}
+
+	LatencyCounts LatencyHistogram::totalCounts() const {
+		LatencyCounts counts;
+		read_counts(counts);
+		counts.maximum = maximum.load(std::memory_order_relaxed);
+		return counts;
+	}
+
+	LatencyCounts LatencyHistogram::intervalCounts() {
+		LatencyCounts current;
+		read_counts(current);
+
+		LatencyCounts interval;
+		for (uint32_t i = 0; i < LATENCY_BUCKET_COUNT; i++) {
+			interval.buckets[i] = current.buckets[i] - previousCounts.buckets[i];
+		}
+		interval.count = current.count - previousCounts.count;
+		interval.total = current.total - previousCounts.total;
+		interval.maximum = intervalMaximum.exchange(0, std::memory_order_relaxed);
+
+		previousCounts = current;
+		return interval;
+	}
+
+	LatencySummary LatencyCounts::summarize() const {
+		LatencySummary summary;
+		summary.count = count;
+		if (count == 0) {
+			return summary;
+		}
+
+		// A duration recorded while the counters were read may be in the buckets but not in the maximum
+		uint32_t lastBucket = 0;
+		for (uint32_t i = 0; i < LATENCY_BUCKET_COUNT; i++) {
+			if (buckets[i] > 0) {
+				lastBucket = i;
+			}
+		}
+		uint64_t maximumValue = std::max(maximum, LatencyHistogram::bucketLowerBound(lastBucket));
+
+		// Highest duration of the bucket that holds the percentile, bounded by the maximum
+		auto percentile = [&](double quantile) {
+			uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(quantile * count)));
+			uint64_t cumulative = 0;
+			for (uint32_t i = 0; i < LATENCY_BUCKET_COUNT; i++) {
+				cumulative += buckets[i];
+				if (cumulative >= rank) {
+					return static_cast<double>(std::min(LatencyHistogram::bucketUpperBound(i) - 1, maximumValue));
+				}
+			}
+			return static_cast<double>(maximumValue);
+		};
+
+		summary.mean = static_cast<double>(total) / count;
+		summary.p50 = percentile(0.5);
+		summary.p90 = percentile(0.9);
+		summary.p99 = percentile(0.99);
+		summary.p999 = percentile(0.999);
+		summary.max = static_cast<double>(maximumValue);
+		return summary;
+	}
+
+	void printLatencySummary(const std::string& name, const LatencySummary& summary) {
+		printf("%-10s %8llu samples, mean %.3f ms, p50 %.3f ms, p90 %.3f ms, p99 %.3f ms, p99.9 %.3f ms, max %.3f ms\n",
+			name.c_str(), static_cast<unsigned long long>(summary.count), summary.mean / 1e6,
+			summary.p50 / 1e6, summary.p90 / 1e6, summary.p99 / 1e6, summary.p999 / 1e6, summary.max / 1e6);
+	}
+
+	void writeLatencyReport(const std::string& path, const std::vector<const LatencyHistogram*>& histograms) {
+		std::ofstream file{path};
+		if (!file.is_open()) {
+			throw std::runtime_error("failed to open file: " + path);
+		}
+
+		bool json = path.size() >= 5 && path.compare(path.size() - 5, 5, ".json") == 0;
+		file << std::fixed << std::setprecision(6);
+
+		if (json) {
+			file << "{\"unit\": \"ms\", \"histograms\": [\n";
+		}
+		else {
+			file << "name,count,mean_ms,p50_ms,p90_ms,p99_ms,p99.9_ms,max_ms\n";
+		}
+
+		for (size_t i = 0; i < histograms.size(); i++) {
+			LatencySummary summary = histograms[i]->totalCounts().summarize();
+			const std::string& name = histograms[i]->name();
+
+			if (json) {
+				file << "{\"name\": \"" << name << "\", \"count\": " << summary.count << ", \"mean\": " << summary.mean / 1e6
+					<< ", \"p50\": " << summary.p50 / 1e6 << ", \"p90\": " << summary.p90 / 1e6 << ", \"p99\": " << summary.p99 / 1e6
+					<< ", \"p99.9\": " << summary.p999 / 1e6 << ", \"max\": " << summary.max / 1e6 << "}"
+					<< (i + 1 < histograms.size() ? ",\n" : "\n");
+			}
+			else {
+				file << name << "," << summary.count << "," << summary.mean / 1e6 << "," << summary.p50 / 1e6 << "," << summary.p90 / 1e6
+					<< "," << summary.p99 / 1e6 << "," << summary.p999 / 1e6 << "," << summary.max / 1e6 << "\n";
+			}
+		}
+
+		if (json) {
+			file << "]}\n";
+		}
+		if (!file) {
+			throw std::runtime_error("failed to write file: " + path);
+		}
+	}
+}
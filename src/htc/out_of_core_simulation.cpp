@@ -0,0 +1,601 @@
+#include "htc/out_of_core_simulation.hpp"
+#include "htc/parameters.hpp"
+#include "htc/display.hpp"
+#include "htc/trace.hpp"
+
+#include "lve/pixel.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+
+// Memory of the resident tile rows (two windows and a convolution output) when their height is not given
+#define OUT_OF_CORE_MEMORY_BUDGET (256LL * 1024 * 1024)
+
+
+namespace htc {
+
+	// Give an advice for the pages of count bytes from begin
+	// NOTE: The released range is rounded inwards, so that the pages shared with the neighbouring bands stay resident
+	static void advisePages(const void* begin, size_t count, int advice) {
+		static const uintptr_t pageSize = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+
+		uintptr_t first = reinterpret_cast<uintptr_t>(begin);
+		uintptr_t last = first + count;
+		if (advice == MADV_DONTNEED) {
+			first = (first + pageSize - 1) / pageSize * pageSize;
+			last = last / pageSize * pageSize;
+		}
+		else {
+			first = first / pageSize * pageSize;
+			last = (last + pageSize - 1) / pageSize * pageSize;
+		}
+
+		// Only a hint, a failure costs some reads
+		if (first < last) {
+			madvise(reinterpret_cast<void*>(first), last - first, advice);
+		}
+	}
+
+	int defaultTileRowHeight(const SimulationConfig& config) {
+		long long radius = config.kernelRadius;
+		long long paddedRow = static_cast<long long>(config.channels) * (config.width + 2 * radius) * sizeof(float);
+		long long outputRow = static_cast<long long>(config.channels) * config.width * sizeof(float);
+
+		// Two windows of rows + 2 * radius rows and the convolution output of one band
+		long long rows = (OUT_OF_CORE_MEMORY_BUDGET - 4 * radius * paddedRow) / (2 * paddedRow + outputRow);
+
+		// Thinner tile rows would read their halo more than their own rows
+		rows = std::max(rows, radius);
+		return static_cast<int>(std::min<long long>(rows, config.height));
+	}
+
+	OutOfCoreSimulation::OutOfCoreSimulation(const SimulationConfig& config) :
+		threadPool(config.threadCount), width(config.width), height(config.height), depth(config.channels),
+		batch(config.batchSize), kernelRadius(config.kernelRadius), kernelSize(2 * config.kernelRadius + 1),
+		boundary(config.boundary), colorPass(config.colorPass), precision(config.precision),
+		footprint(computeDisplayFootprint({}, config.width, config.height)), leniaParameters(initialParameters(config)),
+		rowKernel(selectDirectRowKernel(config.kernelRadius, config.channels)), worldFilePath(config.worldFilePath) {
+
+		// The convolution of a band only sees its window, the FFT and separable modes need the whole world
+		if (config.convolution != ConvolutionMode::Direct && config.convolution != ConvolutionMode::Auto) {
+			throw std::invalid_argument("The out-of-core backend only supports the direct convolution");
+		}
+		if (config.tileSize < 0) {
+			throw std::invalid_argument("The tile size can't be negative");
+		}
+
+		bandRows = std::min(height, config.tileSize > 0 ? config.tileSize : defaultTileRowHeight(config));
+		bandCount = (height + bandRows - 1) / bandRows;
+		bandReach = (kernelRadius + bandRows - 1) / bandRows;
+
+		worldSize = static_cast<size_t>(width) * height * depth;
+		copySize = worldSize * batch;
+
+		size_t windowSize = static_cast<size_t>(depth) * (bandRows + 2 * kernelRadius) * (width + 2 * kernelRadius);
+		windows[0].resize(windowSize);
+		windows[1].resize(windowSize);
+		bandIntermediate.resize(static_cast<size_t>(depth) * bandRows * width);
+
+		worldGrowth.assign(batch, leniaParameters.growth);
+		kernel.assign(depth * depth * kernelSize * kernelSize, 0.0f);
+		initKernelTensor(depth, kernelRadius, leniaParameters.rings, kernel.data());
+
+		init_file();
+
+		// Initialize Lenia with random values, each world has its own seed
+		uint64_t seed = initialSeed(config);
+		for (int world = 0; world < batch; world++) {
+			resetWorld(world, seed + world);
+		}
+
+		// Started last, nothing can throw past it
+		loaderThread = std::thread(&OutOfCoreSimulation::loader_loop, this);
+	}
+
+	OutOfCoreSimulation::~OutOfCoreSimulation() {
+		{
+			std::lock_guard<std::mutex> lock(loaderMutex);
+			loaderRunning = false;
+		}
+		loaderCondition.notify_all();
+		loaderThread.join();
+
+		if (mapping != nullptr) {
+			munmap(mapping, mappingSize);
+		}
+	}
+
+	void OutOfCoreSimulation::init_file() {
+		std::string path = worldFilePath;
+		int descriptor;
+
+		if (path.empty()) {
+			path = (std::filesystem::temp_directory_path() / "lenia-world-XXXXXX").string();
+			descriptor = mkstemp(path.data());
+			if (descriptor < 0) {
+				throw std::runtime_error("failed to create file: " + path);
+			}
+
+			// The mapping keeps the file alive, it is removed with the backend even if the process is killed
+			unlink(path.c_str());
+		}
+		else {
+			descriptor = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+			if (descriptor < 0) {
+				throw std::runtime_error("failed to open file: " + path);
+			}
+		}
+
+		mappingSize = 2 * copySize * sizeof(float);
+		if (ftruncate(descriptor, static_cast<off_t>(mappingSize)) != 0) {
+			close(descriptor);
+			throw std::runtime_error("failed to resize file: " + path);
+		}
+
+		// The blocks are reserved now, a full disk would otherwise kill the process with SIGBUS in the middle of a step
+		// NOTE: The file systems without fallocate keep a sparse file
+		if (posix_fallocate(descriptor, 0, static_cast<off_t>(mappingSize)) == ENOSPC) {
+			close(descriptor);
+			throw std::runtime_error("Not enough disk space for the worlds: " + std::to_string(mappingSize) + " bytes in " + path);
+		}
+
+		// The mapping keeps the file open, the descriptor is not needed anymore
+		void* address = mmap(nullptr, mappingSize, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+		close(descriptor);
+		if (address == MAP_FAILED) {
+			throw std::runtime_error("failed to map file: " + path);
+		}
+		mapping = static_cast<float*>(address);
+
+		// The bands are read and written in order, the kernel can read ahead and drop the pages behind
+		madvise(mapping, mappingSize, MADV_SEQUENTIAL);
+	}
+
+	void OutOfCoreSimulation::check_world(int world) const {
+		if (world < 0 || world >= batch) {
+			throw std::out_of_range("World " + std::to_string(world) + " in a batch of " + std::to_string(batch));
+		}
+	}
+
+	int OutOfCoreSimulation::band_height(int band) const {
+		return std::min(bandRows, height - band * bandRows);
+	}
+
+	float* OutOfCoreSimulation::band_data(int copy, int world, int band) const {
+		// All the bands above are full
+		return mapping + copy * copySize + world * worldSize + static_cast<size_t>(band) * bandRows * depth * width;
+	}
+
+	float* OutOfCoreSimulation::row_data(int copy, int world, int channel, int y) const {
+		int band = y / bandRows;
+		return band_data(copy, world, band) + (static_cast<size_t>(channel) * band_height(band) + y % bandRows) * width;
+	}
+
+	void OutOfCoreSimulation::prefetch_band(int copy, int world, int band) const {
+		advisePages(band_data(copy, world, band), static_cast<size_t>(depth) * band_height(band) * width * sizeof(float), MADV_WILLNEED);
+	}
+
+	void OutOfCoreSimulation::release_band(int copy, int world, int band) const {
+		advisePages(band_data(copy, world, band), static_cast<size_t>(depth) * band_height(band) * width * sizeof(float), MADV_DONTNEED);
+	}
+
+	void OutOfCoreSimulation::load_window(int world, int band, float* window) const {
+		int paddedWidth = width + 2 * kernelRadius;
+		int paddedHeight = band_height(band) + 2 * kernelRadius;
+
+		for (int z = 0; z < depth; z++) {
+			for (int py = 0; py < paddedHeight; py++) {
+				float* row = &window[(static_cast<size_t>(z) * paddedHeight + py) * paddedWidth];
+				int y = band * bandRows + py - kernelRadius;
+
+				if (y < 0 || y >= height) {
+					if (boundary == BoundaryMode::Zero) {
+						std::fill(row, row + paddedWidth, 0.0f);
+						continue;
+					}
+					y = ((y % height) + height) % height;
+				}
+
+				const float* source = row_data(current, world, z, y);
+				std::copy(source, source + width, row + kernelRadius);
+
+				// Left and right halos, the periodic one can wrap around a world narrower than the radius
+				for (int i = 0; i < kernelRadius; i++) {
+					if (boundary == BoundaryMode::Zero) {
+						row[i] = 0.0f;
+						row[kernelRadius + width + i] = 0.0f;
+					}
+					else {
+						row[i] = source[(((i - kernelRadius) % width) + width) % width];
+						row[kernelRadius + width + i] = source[i % width];
+					}
+				}
+			}
+		}
+	}
+
+	void OutOfCoreSimulation::loader_loop() {
+		setTraceThreadName("out-of-core loader");
+
+		std::unique_lock<std::mutex> lock(loaderMutex);
+		while (true) {
+			loaderCondition.wait(lock, [this] { return loadPending || !loaderRunning; });
+			if (!loadPending) {
+				return;
+			}
+
+			// The request stays pending until the window is complete, the processing never reads a partial one
+			lock.unlock();
+			std::exception_ptr error;
+			try {
+				TRACE_SCOPE("load window");
+				load_window(loadWorld, loadBand, loadWindow);
+			}
+			catch (...) {
+				error = std::current_exception();
+			}
+			lock.lock();
+
+			loadError = error;
+			loadPending = false;
+			loaderCondition.notify_all();
+		}
+	}
+
+	void OutOfCoreSimulation::request_load(int world, int band, float* window) {
+		{
+			std::lock_guard<std::mutex> lock(loaderMutex);
+			loadWorld = world;
+			loadBand = band;
+			loadWindow = window;
+			loadPending = true;
+		}
+		loaderCondition.notify_all();
+	}
+
+	void OutOfCoreSimulation::wait_load() {
+		std::unique_lock<std::mutex> lock(loaderMutex);
+		loaderCondition.wait(lock, [this] { return !loadPending; });
+
+		if (loadError) {
+			std::exception_ptr error = loadError;
+			loadError = nullptr;
+			std::rethrow_exception(error);
+		}
+	}
+
+	void OutOfCoreSimulation::sweep_windows(const std::function<void(int world, int band, const float* window)>& process) {
+		int bandTotal = batch * bandCount;
+		int spare = 1 - current;
+
+		// Bands read by the first windows, the following ones are prefetched one band ahead of the loads
+		for (int band = 0; band < std::min(bandCount, bandReach + 2); band++) {
+			prefetch_band(current, 0, band);
+			prefetch_band(spare, 0, band);
+		}
+
+		// The loads only read the current copy and the processing only writes the spare one
+		// NOTE: The loads run on the loader thread, the thread pool is busy with the processing
+		request_load(0, 0, windows[0].data());
+
+		for (int index = 0; index < bandTotal; index++) {
+			int world = index / bandCount;
+			int band = index % bandCount;
+
+			// Rethrows an error of the load
+			wait_load();
+
+			int next = index + 1;
+			if (next < bandTotal) {
+				int ahead = next + bandReach + 1;
+				if (ahead < bandTotal) {
+					prefetch_band(current, ahead / bandCount, ahead % bandCount);
+					prefetch_band(spare, ahead / bandCount, ahead % bandCount);
+				}
+
+				request_load(next / bandCount, next % bandCount, windows[next % 2].data());
+			}
+
+			// An error of the processing still waits for the load in flight, the error of the processing is the one reported
+			try {
+				process(world, band, windows[index % 2].data());
+			}
+			catch (...) {
+				std::unique_lock<std::mutex> lock(loaderMutex);
+				loaderCondition.wait(lock, [this] { return !loadPending; });
+				loadError = nullptr;
+				throw;
+			}
+
+			// The bands behind the next window are not read again by this sweep, except by the periodic halos of the last band
+			int released = band - bandReach;
+			if (released >= 0) {
+				release_band(current, world, released);
+				release_band(spare, world, released);
+			}
+			if (band == bandCount - 1) {
+				for (int tail = std::max(0, released + 1); tail < bandCount; tail++) {
+					release_band(current, world, tail);
+					release_band(spare, world, tail);
+				}
+			}
+		}
+	}
+
+	void OutOfCoreSimulation::convolve_band(const float* window, int rows, float* output) {
+		int paddedWidth = width + 2 * kernelRadius;
+		int paddedHeight = rows + 2 * kernelRadius;
+
+		// Same row kernel as DirectConvolution, so that the sums are rounded the same way
+		threadPool.parallelFor(depth * rows, [&](int begin, int end) {
+			for (int row = begin; row < end; row++) {
+				float* outputRow = &output[static_cast<size_t>(row) * width];
+				rowKernel(kernel.data(), window, paddedWidth, paddedHeight, width, depth, kernelRadius, row / rows, row % rows, outputRow);
+				roundToPrecision(precision, outputRow, width);
+			}
+		});
+	}
+
+	void OutOfCoreSimulation::update_band(int world, int band, const float* state, const float* intermediate, float* updated) {
+		const GrowthParameters& growth = worldGrowth[world];
+
+		// The three arrays are [channel][row][width] bands, updated can be the state
+		threadPool.parallelFor(depth * band_height(band), [&](int begin, int end) {
+			for (int row = begin; row < end; row++) {
+				size_t offset = static_cast<size_t>(row) * width;
+				const float* stateRow = state + offset;
+				const float* intermediateRow = intermediate + offset;
+				float* updatedRow = updated + offset;
+
+				for (int x = 0; x < width; x++) {
+					float normalized = (intermediateRow[x] - growth.mu) / growth.sigma;
+					float t = expf(-normalized * normalized);
+					updatedRow[x] = (1 - growth.timeStep) * stateRow[x] + growth.timeStep * t;
+				}
+				roundToPrecision(precision, updatedRow, width);
+			}
+		});
+	}
+
+	void OutOfCoreSimulation::color_band(int copy, int band, lve::Pixel* output, int& nextPixelRow) {
+		int bandEnd = band * bandRows + band_height(band);
+
+		int first = nextPixelRow;
+		int last = first;
+		while (last < footprint.height && footprint.rows[2 * last + 1] <= bandEnd) {
+			last++;
+		}
+
+		// A pixel row may cover the end of the bands above, they are read again from the page cache
+		threadPool.parallelFor(last - first, [&](int begin, int end) {
+			colorViewRows(footprint, depth, first + begin, first + end, output, [&](int z, int y, int x, int) {
+				return static_cast<const float*>(row_data(copy, 0, z, y) + x);
+			});
+		});
+		nextPixelRow = last;
+	}
+
+	void OutOfCoreSimulation::update_color(lve::Pixel* output) {
+		int spare = 1 - current;
+		int nextPixelRow = 0;
+
+		// No halo is needed, the bands are updated in place from the convolution stored in the spare copy
+		for (int world = 0; world < batch; world++) {
+			for (int band = 0; band < bandCount; band++) {
+				if (band + 1 < bandCount) {
+					prefetch_band(current, world, band + 1);
+					prefetch_band(spare, world, band + 1);
+				}
+
+				float* state = band_data(current, world, band);
+				update_band(world, band, state, band_data(spare, world, band), state);
+
+				// Only the first world is colored
+				if (world == 0 && output != nullptr) {
+					color_band(current, band, output, nextPixelRow);
+				}
+
+				release_band(current, world, band);
+				release_band(spare, world, band);
+			}
+		}
+	}
+
+	void OutOfCoreSimulation::setDisplayView(const DisplayView& view) {
+		footprint = computeDisplayFootprint(view, width, height);
+	}
+
+	void OutOfCoreSimulation::runConvolution() {
+		TRACE_SCOPE("convolution");
+
+		int spare = 1 - current;
+		sweep_windows([&](int world, int band, const float* window) {
+			convolve_band(window, band_height(band), band_data(spare, world, band));
+		});
+	}
+
+	void OutOfCoreSimulation::runUpdate() {
+		TRACE_SCOPE("update");
+		update_color(nullptr);
+	}
+
+	void OutOfCoreSimulation::runColor(lve::Pixel* output) {
+		TRACE_SCOPE("color");
+
+		threadPool.parallelFor(footprint.height, [&](int begin, int end) {
+			colorViewRows(footprint, depth, begin, end, output, [&](int z, int y, int x, int) {
+				return static_cast<const float*>(row_data(current, 0, z, y) + x);
+			});
+		});
+	}
+
+	void OutOfCoreSimulation::runUpdateColor(lve::Pixel* output) {
+		TRACE_SCOPE("update+color");
+		update_color(output);
+	}
+
+	void OutOfCoreSimulation::step(lve::Pixel* output) {
+		TRACE_SCOPE("step");
+
+		// Each band is convolved, updated into the spare copy and colored while it is resident
+		int spare = 1 - current;
+		lve::Pixel* fusedOutput = colorPass == ColorPass::Fused ? output : nullptr;
+		int nextPixelRow = 0;
+
+		sweep_windows([&](int world, int band, const float* window) {
+			convolve_band(window, band_height(band), bandIntermediate.data());
+			update_band(world, band, band_data(current, world, band), bandIntermediate.data(), band_data(spare, world, band));
+
+			if (world == 0 && fusedOutput != nullptr) {
+				color_band(spare, band, fusedOutput, nextPixelRow);
+			}
+		});
+		current = spare;
+
+		if (output != nullptr && fusedOutput == nullptr) {
+			runColor(output);
+		}
+	}
+
+	void OutOfCoreSimulation::setParameters(const LeniaParameters& parameters) {
+		// Build the new kernels first, so that invalid parameters leave the simulation unchanged
+		std::vector<float> newKernel(depth * depth * kernelSize * kernelSize, 0.0f);
+		initKernelTensor(depth, kernelRadius, parameters.rings, newKernel.data());
+
+		kernel = std::move(newKernel);
+		leniaParameters = parameters;
+		worldGrowth.assign(batch, parameters.growth);
+	}
+
+	void OutOfCoreSimulation::setWorldGrowth(int world, const GrowthParameters& growth) {
+		check_world(world);
+		worldGrowth[world] = growth;
+	}
+
+	const GrowthParameters& OutOfCoreSimulation::growth(int world) const {
+		check_world(world);
+		return worldGrowth[world];
+	}
+
+	void OutOfCoreSimulation::resetWorld(int world, uint64_t seed) {
+		check_world(world);
+
+		// Same random state as the other backends, generated row by row straight into the file
+		RandomStateStream stream{seed};
+		for (int z = 0; z < depth; z++) {
+			for (int y = 0; y < height; y++) {
+				float* row = row_data(current, world, z, y);
+				stream.fill(width, row);
+				roundToPrecision(precision, row, width);
+			}
+		}
+	}
+
+	void OutOfCoreSimulation::writeWorldState(int world, const float* h_state) {
+		check_world(world);
+
+		threadPool.parallelFor(depth * height, [&](int begin, int end) {
+			for (int plane = begin; plane < end; plane++) {
+				const float* source = &h_state[static_cast<size_t>(plane) * width];
+				float* row = row_data(current, world, plane / height, plane % height);
+
+				std::copy(source, source + width, row);
+				roundToPrecision(precision, row, width);
+			}
+		});
+	}
+
+	void OutOfCoreSimulation::readState(float* h_state) {
+		for (int world = 0; world < batch; world++) {
+			readWorldState(world, &h_state[world * worldSize]);
+		}
+	}
+
+	void OutOfCoreSimulation::readWorldState(int world, float* h_state) {
+		check_world(world);
+
+		threadPool.parallelFor(depth * height, [&](int begin, int end) {
+			for (int plane = begin; plane < end; plane++) {
+				const float* row = row_data(current, world, plane / height, plane % height);
+				std::copy(row, row + width, &h_state[static_cast<size_t>(plane) * width]);
+			}
+		});
+	}
+
+	void OutOfCoreSimulation::streamWorldState(int world, const std::function<void(const float* values, size_t count)>& consume) {
+		check_world(world);
+
+		// The rows of a channel of a band are contiguous in the file, they are handed straight from the mapping
+		for (int z = 0; z < depth; z++) {
+			for (int band = 0; band < bandCount; band++) {
+				const float* rows = row_data(current, world, z, band * bandRows);
+				size_t count = static_cast<size_t>(band_height(band)) * width;
+
+				if (band + 1 < bandCount) {
+					advisePages(row_data(current, world, z, (band + 1) * bandRows), static_cast<size_t>(band_height(band + 1)) * width * sizeof(float), MADV_WILLNEED);
+				}
+				consume(rows, count);
+				advisePages(rows, count * sizeof(float), MADV_DONTNEED);
+			}
+		}
+	}
+
+	std::vector<WorldMetrics> OutOfCoreSimulation::readMetrics() {
+		std::vector<WorldMetrics> metrics(batch);
+		std::vector<double> rowMass(static_cast<size_t>(depth) * bandRows);
+		std::vector<float> rowMaximum(static_cast<size_t>(depth) * bandRows);
+
+		// One band at a time, one task per row, then the rows are summed in order in double precision
+		for (int world = 0; world < batch; world++) {
+			metrics[world].mass.assign(depth, 0.0f);
+			metrics[world].maximum.assign(depth, 0.0f);
+			std::vector<double> mass(depth, 0.0);
+
+			for (int band = 0; band < bandCount; band++) {
+				int rows = band_height(band);
+				const float* state = band_data(current, world, band);
+				if (band + 1 < bandCount) {
+					prefetch_band(current, world, band + 1);
+				}
+
+				threadPool.parallelFor(depth * rows, [&](int begin, int end) {
+					for (int row = begin; row < end; row++) {
+						const float* values = state + static_cast<size_t>(row) * width;
+
+						double sum = 0.0;
+						float maximum = 0.0f;
+						for (int x = 0; x < width; x++) {
+							sum += values[x];
+							maximum = std::max(maximum, values[x]);
+						}
+						rowMass[row] = sum;
+						rowMaximum[row] = maximum;
+					}
+				});
+
+				for (int row = 0; row < depth * rows; row++) {
+					int z = row / rows;
+					mass[z] += rowMass[row];
+					metrics[world].maximum[z] = std::max(metrics[world].maximum[z], rowMaximum[row]);
+				}
+				release_band(current, world, band);
+			}
+
+			for (int z = 0; z < depth; z++) {
+				metrics[world].mass[z] = static_cast<float>(mass[z]);
+			}
+		}
+
+		return metrics;
+	}
+}
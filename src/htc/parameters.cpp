@@ -0,0 +1,135 @@
+#include "htc/parameters.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+
+namespace htc {
+
+	void fillGaussianKernel(int depth, int kernelRadius, int sourceChannel, int targetChannel, float mu, float sigma, float weight, float* h_kernel) {
+		int kernelSize = 2 * kernelRadius + 1;
+		int globalIdx = targetChannel * (depth * kernelSize * kernelSize)	// F: Position in the target channel
+		  + sourceChannel * (kernelSize * kernelSize);        			// C: Position in the source channel
+
+		int locX, locY, localIdx;
+		float distDelta, normalized;
+
+		// Traverse the kernel centering the values
+		int halfSize = kernelRadius;
+		for (int h = -halfSize; h <= halfSize; h++) {
+			for (int w = -halfSize; w <= halfSize; w++) {
+				// Calculate local position
+				locX = w + halfSize;
+				locY = h + halfSize;
+				localIdx = locY * kernelSize + locX;
+
+				// Calculate normalized distance to the center
+				distDelta = sqrtf(h * h + w * w) - mu;
+				normalized = distDelta * distDelta / (2 * sigma * sigma);
+				h_kernel[globalIdx + localIdx] += weight * expf(-normalized);
+			}
+		}
+	}
+
+	LeniaParameters defaultParameters(int depth) {
+		LeniaParameters parameters;
+
+		const float shapes[3][2] = { {4.0f, 1.0f}, {8.0f, 2.0f}, {12.0f, 3.0f} };
+
+		for (int i = 0; i < depth; i++) {
+			for (int offset = 0; offset < 3; offset++) {
+				KernelRing ring{i, (i + offset) % depth, shapes[offset][0], shapes[offset][1]};
+
+				// With less than 3 channels, the last ring of a pair replaces the previous ones
+				auto samePair = [&](const KernelRing& other) { return other.source == ring.source && other.target == ring.target; };
+				parameters.rings.erase(std::remove_if(parameters.rings.begin(), parameters.rings.end(), samePair), parameters.rings.end());
+
+				parameters.rings.push_back(ring);
+			}
+		}
+
+		return parameters;
+	}
+
+	LeniaParameters loadParameters(const std::string& path) {
+		std::ifstream file{path};
+		if (!file.is_open()) {
+			throw std::runtime_error("failed to open file: " + path);
+		}
+
+		LeniaParameters parameters;
+
+		std::string line;
+		int lineNumber = 0;
+		while (std::getline(file, line)) {
+			lineNumber++;
+
+			line = line.substr(0, line.find('#'));
+			std::istringstream stream{line};
+
+			std::string key;
+			if (!(stream >> key)) {
+				continue;
+			}
+
+			bool valid;
+			if (key == "growth_mu") {
+				valid = static_cast<bool>(stream >> parameters.growth.mu);
+			}
+			else if (key == "growth_sigma") {
+				valid = static_cast<bool>(stream >> parameters.growth.sigma) && parameters.growth.sigma > 0.0f;
+			}
+			else if (key == "time_step") {
+				valid = static_cast<bool>(stream >> parameters.growth.timeStep);
+			}
+			else if (key == "ring") {
+				KernelRing ring{};
+				valid = static_cast<bool>(stream >> ring.source >> ring.target >> ring.mu >> ring.sigma) && ring.sigma > 0.0f;
+
+				// The weight is optional
+				ring.weight = 1.0f;
+				if (valid && !(stream >> ring.weight)) {
+					ring.weight = 1.0f;
+					stream.clear();
+				}
+				parameters.rings.push_back(ring);
+			}
+			else {
+				throw std::runtime_error(path + ":" + std::to_string(lineNumber) + ": unknown parameter " + key);
+			}
+
+			std::string extra;
+			if (!valid || (stream >> extra)) {
+				throw std::runtime_error(path + ":" + std::to_string(lineNumber) + ": invalid value for " + key);
+			}
+		}
+
+		return parameters;
+	}
+
+	void initKernelTensor(int depth, int kernelRadius, const std::vector<KernelRing>& rings, float* h_kernel) {
+		// The mass of a ring grows with the square of its scale
+		float scale = static_cast<float>(kernelRadius) / KERNEL_RADIUS;
+		float weight = 1.0f / (scale * scale);
+
+		// Pairs without any ring stay zero
+		int kernelSize = 2 * kernelRadius + 1;
+		std::fill(h_kernel, h_kernel + depth * depth * kernelSize * kernelSize, 0.0f);
+
+		for (const KernelRing& ring : rings) {
+			if (ring.source < 0 || ring.source >= depth || ring.target < 0 || ring.target >= depth) {
+				throw std::invalid_argument("Kernel ring between channels " + std::to_string(ring.source) + " and "
+					+ std::to_string(ring.target) + " in a simulation of " + std::to_string(depth) + " channels");
+			}
+
+			fillGaussianKernel(depth, kernelRadius, ring.source, ring.target, ring.mu * scale, ring.sigma * scale, ring.weight * weight, h_kernel);
+		}
+	}
+
+	void initKernelTensor(int depth, int kernelRadius, float* h_kernel) {
+		initKernelTensor(depth, kernelRadius, defaultParameters(depth).rings, h_kernel);
+	}
+}
@@ -0,0 +1,173 @@
+#include "htc/precision.hpp"
+
+#include <cstring>
+#include <stdexcept>
+
+
+namespace htc {
+
+	Precision parsePrecision(const std::string& name) {
+		if (name == "fp32") {
+			return Precision::Float32;
+		}
+		if (name == "fp16") {
+			return Precision::Float16;
+		}
+		if (name == "bf16") {
+			return Precision::BFloat16;
+		}
+
+		throw std::invalid_argument("Unknown precision: " + name);
+	}
+
+	const char* precisionName(Precision precision) {
+		switch (precision) {
+			case Precision::Float16:
+				return "fp16";
+			case Precision::BFloat16:
+				return "bf16";
+			default:
+				return "fp32";
+		}
+	}
+
+	size_t precisionSize(Precision precision) {
+		return precision == Precision::Float32 ? sizeof(float) : sizeof(uint16_t);
+	}
+
+	uint16_t floatToHalf(float value) {
+		uint32_t bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+
+		uint32_t sign = (bits >> 16) & 0x8000;
+		uint32_t exponent = (bits >> 23) & 0xff;
+		uint32_t mantissa = bits & 0x7fffff;
+
+		// NaN and infinity
+		if (exponent == 0xff) {
+			return static_cast<uint16_t>(sign | 0x7c00 | (mantissa != 0 ? 0x200 : 0));
+		}
+
+		int halfExponent = static_cast<int>(exponent) - 127 + 15;
+
+		// Overflow to infinity
+		if (halfExponent >= 0x1f) {
+			return static_cast<uint16_t>(sign | 0x7c00);
+		}
+
+		// Normal numbers: drop 13 bits of mantissa, rounding to nearest even
+		// NOTE: A carry out of the mantissa correctly increments the exponent
+		if (halfExponent > 0) {
+			uint32_t half = (static_cast<uint32_t>(halfExponent) << 10) | (mantissa >> 13);
+			uint32_t remainder = mantissa & 0x1fff;
+			if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1) != 0)) {
+				half++;
+			}
+			return static_cast<uint16_t>(sign | half);
+		}
+
+		// Too small even for a subnormal
+		if (halfExponent < -10) {
+			return static_cast<uint16_t>(sign);
+		}
+
+		// Subnormal numbers: shift the mantissa with its implicit bit
+		mantissa |= 0x800000;
+		int shift = 14 - halfExponent;
+		uint32_t half = mantissa >> shift;
+		uint32_t remainder = mantissa & ((1u << shift) - 1);
+		uint32_t halfway = 1u << (shift - 1);
+		if (remainder > halfway || (remainder == halfway && (half & 1) != 0)) {
+			half++;
+		}
+		return static_cast<uint16_t>(sign | half);
+	}
+
+	float halfToFloat(uint16_t value) {
+		uint32_t sign = static_cast<uint32_t>(value & 0x8000) << 16;
+		uint32_t exponent = (value >> 10) & 0x1f;
+		uint32_t mantissa = value & 0x3ff;
+
+		uint32_t bits;
+		if (exponent == 0x1f) {
+			bits = sign | 0x7f800000 | (mantissa << 13);
+		}
+		else if (exponent != 0) {
+			bits = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+		}
+		else if (mantissa == 0) {
+			bits = sign;
+		}
+		else {
+			// Normalize the subnormal
+			exponent = 127 - 15 + 1;
+			while ((mantissa & 0x400) == 0) {
+				mantissa <<= 1;
+				exponent--;
+			}
+			bits = sign | (exponent << 23) | ((mantissa & 0x3ff) << 13);
+		}
+
+		float result;
+		std::memcpy(&result, &bits, sizeof(result));
+		return result;
+	}
+
+	uint16_t floatToBfloat16(float value) {
+		uint32_t bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+
+		// Keep NaNs quiet instead of rounding them to infinity
+		if ((bits & 0x7fffffff) > 0x7f800000) {
+			return static_cast<uint16_t>((bits >> 16) | 0x40);
+		}
+
+		uint32_t rounding = 0x7fff + ((bits >> 16) & 1);
+		return static_cast<uint16_t>((bits + rounding) >> 16);
+	}
+
+	float bfloat16ToFloat(uint16_t value) {
+		uint32_t bits = static_cast<uint32_t>(value) << 16;
+
+		float result;
+		std::memcpy(&result, &bits, sizeof(result));
+		return result;
+	}
+
+	void convertToStorage(Precision precision, const float* values, size_t count, void* storage) {
+		if (precision == Precision::Float32) {
+			std::memcpy(storage, values, count * sizeof(float));
+			return;
+		}
+
+		uint16_t* packed = static_cast<uint16_t*>(storage);
+		for (size_t i = 0; i < count; i++) {
+			packed[i] = precision == Precision::Float16 ? floatToHalf(values[i]) : floatToBfloat16(values[i]);
+		}
+	}
+
+	void convertFromStorage(Precision precision, const void* storage, size_t count, float* values) {
+		if (precision == Precision::Float32) {
+			std::memcpy(values, storage, count * sizeof(float));
+			return;
+		}
+
+		const uint16_t* packed = static_cast<const uint16_t*>(storage);
+		for (size_t i = 0; i < count; i++) {
+			values[i] = precision == Precision::Float16 ? halfToFloat(packed[i]) : bfloat16ToFloat(packed[i]);
+		}
+	}
+
+	void roundToPrecision(Precision precision, float* values, size_t count) {
+		if (precision == Precision::Float16) {
+			for (size_t i = 0; i < count; i++) {
+				values[i] = halfToFloat(floatToHalf(values[i]));
+			}
+		}
+		else if (precision == Precision::BFloat16) {
+			for (size_t i = 0; i < count; i++) {
+				values[i] = bfloat16ToFloat(floatToBfloat16(values[i]));
+			}
+		}
+	}
+}
@@ -0,0 +1,145 @@
+#include "htc/regression.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+
+namespace htc {
+
+	StateError measureStateError(const float* reference, const float* state, size_t count) {
+		StateError error;
+		if (count == 0) {
+			return error;
+		}
+
+		// Accumulated in double, the sums of large worlds would lose the small errors in fp32
+		double squares = 0.0;
+		double referenceMass = 0.0;
+		double mass = 0.0;
+		for (size_t i = 0; i < count; i++) {
+			double difference = std::abs(static_cast<double>(state[i]) - reference[i]);
+			error.maxError = std::max(error.maxError, difference);
+			squares += difference * difference;
+			referenceMass += reference[i];
+			mass += state[i];
+		}
+
+		// A NaN never compares greater, it is reported as an infinite error
+		if (std::isnan(squares) || std::isnan(mass)) {
+			error.maxError = INFINITY;
+		}
+
+		error.rmsError = std::sqrt(squares / count);
+
+		// An empty reference gives the absolute mass of the state
+		error.massDrift = referenceMass != 0.0 ? (mass - referenceMass) / referenceMass : mass;
+		return error;
+	}
+
+	StateError goldenThresholds(ConvolutionMode convolution, Precision precision) {
+		// Direct fp32 only differs by the order of the sums (MIOpen), measured at 0 on the CPU backends
+		StateError thresholds = {1e-3, 1e-4, 1e-4};
+
+		// Measured 2.3e-3, 1.6e-4 and 8.7e-5 for the FFT, 3.2e-2, 1.4e-3 and 2.8e-4 for the separable at its default tolerance
+		// NOTE: The auto mode can pick either, it gets the loosest one
+		StateError modeThresholds = thresholds;
+		if (convolution == ConvolutionMode::Fft) {
+			modeThresholds = {1e-2, 1e-3, 5e-4};
+		}
+		else if (convolution == ConvolutionMode::Separable || convolution == ConvolutionMode::Auto) {
+			modeThresholds = {1e-1, 5e-3, 1e-3};
+		}
+
+		// Measured 8.4e-2, 6.5e-3 and 1.8e-3 for fp16, and 0.49, 3.9e-2 and 1.8e-2 for bf16 whose run has diverged by then
+		StateError precisionThresholds = thresholds;
+		if (precision == Precision::Float16) {
+			precisionThresholds = {0.25, 2e-2, 5e-3};
+		}
+		else if (precision == Precision::BFloat16) {
+			precisionThresholds = {1.0, 0.1, 5e-2};
+		}
+
+		thresholds.maxError = std::max(modeThresholds.maxError, precisionThresholds.maxError);
+		thresholds.rmsError = std::max(modeThresholds.rmsError, precisionThresholds.rmsError);
+		thresholds.massDrift = std::max(modeThresholds.massDrift, precisionThresholds.massDrift);
+		return thresholds;
+	}
+
+	void writeGoldenManifest(const std::string& directory, const GoldenManifest& manifest) {
+		std::string path = (std::filesystem::path(directory) / GOLDEN_MANIFEST_NAME).string();
+		std::ofstream file{path};
+		if (!file.is_open()) {
+			throw std::runtime_error("failed to open file: " + path);
+		}
+
+		file << "# LeniAMD golden states, one checkpoint per step\n";
+		file << "seed " << manifest.seed << "\n";
+		file << "reference " << manifest.reference << "\n";
+		file << "steps";
+		for (uint64_t step : manifest.steps) {
+			file << " " << step;
+		}
+		file << "\n";
+
+		if (!file) {
+			throw std::runtime_error("failed to write file: " + path);
+		}
+	}
+
+	GoldenManifest readGoldenManifest(const std::string& directory) {
+		std::string path = (std::filesystem::path(directory) / GOLDEN_MANIFEST_NAME).string();
+		std::ifstream file{path};
+		if (!file.is_open()) {
+			throw std::runtime_error("failed to open file: " + path);
+		}
+
+		GoldenManifest manifest;
+		bool hasSeed = false;
+
+		std::string line;
+		while (std::getline(file, line)) {
+			if (line.empty() || line[0] == '#') {
+				continue;
+			}
+
+			std::istringstream stream{line};
+			std::string key;
+			stream >> key;
+
+			if (key == "seed") {
+				hasSeed = static_cast<bool>(stream >> manifest.seed);
+			}
+			else if (key == "reference") {
+				std::getline(stream >> std::ws, manifest.reference);
+			}
+			else if (key == "steps") {
+				uint64_t step;
+				while (stream >> step) {
+					manifest.steps.push_back(step);
+				}
+			}
+			else {
+				throw std::runtime_error("Unknown key in " + path + ": " + key);
+			}
+		}
+
+		if (!hasSeed || manifest.steps.empty()) {
+			throw std::runtime_error("Incomplete golden manifest: " + path);
+		}
+		if (!std::is_sorted(manifest.steps.begin(), manifest.steps.end())) {
+			throw std::runtime_error("The golden steps are not in increasing order: " + path);
+		}
+		return manifest;
+	}
+
+	std::string goldenSnapshotPath(const std::string& directory, uint64_t step) {
+		char name[64];
+		snprintf(name, sizeof(name), "golden_%012llu.lenia", static_cast<unsigned long long>(step));
+		return (std::filesystem::path(directory) / name).string();
+	}
+}
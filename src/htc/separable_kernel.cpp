@@ -0,0 +1,150 @@
+#include "htc/separable_kernel.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <numeric>
+
+
+// Maximum number of Jacobi sweeps, convergence usually takes less than 10
+#define JACOBI_MAX_SWEEPS 50
+
+
+namespace htc {
+
+	SeparableKernel factorKernel(const float* kernel, int kernelSize, float tolerance) {
+		int n = kernelSize;
+
+		// One-sided Jacobi: rotate the columns of U = A until they are orthogonal, V accumulates the rotations
+		// then A = U V^T, where the norms of the columns of U are the singular values
+		std::vector<double> u(kernel, kernel + n * n);
+		std::vector<double> v(n * n, 0.0);
+		for (int i = 0; i < n; i++) {
+			v[i * n + i] = 1.0;
+		}
+
+		for (int sweep = 0; sweep < JACOBI_MAX_SWEEPS; sweep++) {
+			bool rotated = false;
+
+			for (int p = 0; p < n - 1; p++) {
+				for (int q = p + 1; q < n; q++) {
+					double alpha = 0.0, beta = 0.0, gamma = 0.0;
+					for (int i = 0; i < n; i++) {
+						alpha += u[i * n + p] * u[i * n + p];
+						beta += u[i * n + q] * u[i * n + q];
+						gamma += u[i * n + p] * u[i * n + q];
+					}
+
+					if (std::abs(gamma) <= 1e-15 * std::sqrt(alpha * beta)) {
+						continue;
+					}
+					rotated = true;
+
+					// Rotation that zeroes the dot product of columns p and q
+					double zeta = (beta - alpha) / (2.0 * gamma);
+					double t = (zeta >= 0.0 ? 1.0 : -1.0) / (std::abs(zeta) + std::sqrt(1.0 + zeta * zeta));
+					double c = 1.0 / std::sqrt(1.0 + t * t);
+					double s = c * t;
+
+					for (int i = 0; i < n; i++) {
+						double up = u[i * n + p];
+						double uq = u[i * n + q];
+						u[i * n + p] = c * up - s * uq;
+						u[i * n + q] = s * up + c * uq;
+
+						double vp = v[i * n + p];
+						double vq = v[i * n + q];
+						v[i * n + p] = c * vp - s * vq;
+						v[i * n + q] = s * vp + c * vq;
+					}
+				}
+			}
+
+			if (!rotated) {
+				break;
+			}
+		}
+
+		// Singular values, sorted in decreasing order
+		std::vector<double> singular(n);
+		for (int j = 0; j < n; j++) {
+			double norm = 0.0;
+			for (int i = 0; i < n; i++) {
+				norm += u[i * n + j] * u[i * n + j];
+			}
+			singular[j] = std::sqrt(norm);
+		}
+
+		std::vector<int> order(n);
+		std::iota(order.begin(), order.end(), 0);
+		std::sort(order.begin(), order.end(), [&](int a, int b) { return singular[a] > singular[b]; });
+
+		double total = 0.0;
+		for (double value : singular) {
+			total += value * value;
+		}
+
+		SeparableKernel result;
+		if (total == 0.0) {
+			return result;
+		}
+
+		// Keep the fewest components whose residual is within the tolerance
+		// NOTE: The squared residual of a truncated SVD is the sum of the dropped squared singular values
+		double residual = total;
+		int rank = 0;
+		while (rank < n && singular[order[rank]] > 0.0) {
+			residual -= singular[order[rank]] * singular[order[rank]];
+			rank++;
+			if (std::sqrt(std::max(residual, 0.0) / total) <= tolerance) {
+				break;
+			}
+		}
+
+		result.rank = rank;
+		result.relativeError = static_cast<float>(std::sqrt(std::max(residual, 0.0) / total));
+		result.vertical.resize(rank * n);
+		result.horizontal.resize(rank * n);
+
+		// Split each singular value evenly between the two filters
+		for (int k = 0; k < rank; k++) {
+			int j = order[k];
+			double scale = std::sqrt(singular[j]);
+
+			for (int i = 0; i < n; i++) {
+				result.vertical[k * n + i] = static_cast<float>(u[i * n + j] / singular[j] * scale);
+				result.horizontal[k * n + i] = static_cast<float>(v[i * n + j] * scale);
+			}
+		}
+
+		return result;
+	}
+
+	SeparableKernelTensor factorKernelTensor(int depth, int kernelRadius, const float* kernel, float tolerance) {
+		SeparableKernelTensor result;
+		result.kernelSize = 2 * kernelRadius + 1;
+
+		int kernelArea = result.kernelSize * result.kernelSize;
+		for (int pair = 0; pair < depth * depth; pair++) {
+			result.pairs.push_back(factorKernel(kernel + pair * kernelArea, result.kernelSize, tolerance));
+
+			result.components += result.pairs.back().rank;
+			result.maxRelativeError = std::max(result.maxRelativeError, result.pairs.back().relativeError);
+		}
+
+		return result;
+	}
+
+	void printSeparableKernelReport(const SeparableKernelTensor& kernels, float tolerance) {
+		int maxRank = 0;
+		for (const SeparableKernel& pair : kernels.pairs) {
+			maxRank = std::max(maxRank, pair.rank);
+		}
+
+		// Multiply-adds per pixel and per component: one horizontal and one vertical pass
+		printf("Separable convolution: %d components (max rank %d of %d), relative error %.3e (tolerance %.1e), %d MACs per pixel instead of %d\n",
+			kernels.components, maxRank, kernels.kernelSize, kernels.maxRelativeError, tolerance,
+			2 * kernels.kernelSize * kernels.components,
+			kernels.kernelSize * kernels.kernelSize * static_cast<int>(kernels.pairs.size()));
+	}
+}
@@ -0,0 +1,343 @@
+#include "htc/simulation_backend.hpp"
+#include "htc/cpu_simulation.hpp"
+#include "htc/tiled_simulation.hpp"
+#include "htc/out_of_core_simulation.hpp"
+
+#ifdef LENIA_ENABLE_HIP
+#include "htc/lenia_graph.hpp"
+
+#include <hip/hip_runtime.h>
+#endif
+
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <stdexcept>
+
+
+namespace htc {
+
+	BackendType parseBackendType(const std::string& name) {
+		if (name == "auto") {
+			return BackendType::Auto;
+		}
+		if (name == "hip") {
+			return BackendType::Hip;
+		}
+		if (name == "cpu") {
+			return BackendType::Cpu;
+		}
+		if (name == "tiled") {
+			return BackendType::Tiled;
+		}
+		if (name == "out-of-core") {
+			return BackendType::OutOfCore;
+		}
+
+		throw std::invalid_argument("Unknown simulation backend: " + name);
+	}
+
+	ConvolutionMode parseConvolutionMode(const std::string& name) {
+		if (name == "direct") {
+			return ConvolutionMode::Direct;
+		}
+		if (name == "fft") {
+			return ConvolutionMode::Fft;
+		}
+		if (name == "separable") {
+			return ConvolutionMode::Separable;
+		}
+		if (name == "auto") {
+			return ConvolutionMode::Auto;
+		}
+
+		throw std::invalid_argument("Unknown convolution mode: " + name);
+	}
+
+	BoundaryMode parseBoundaryMode(const std::string& name) {
+		if (name == "zero") {
+			return BoundaryMode::Zero;
+		}
+		if (name == "periodic") {
+			return BoundaryMode::Periodic;
+		}
+
+		throw std::invalid_argument("Unknown boundary mode: " + name);
+	}
+
+	ColorPass parseColorPass(const std::string& name) {
+		if (name == "fused") {
+			return ColorPass::Fused;
+		}
+		if (name == "separate") {
+			return ColorPass::Separate;
+		}
+
+		throw std::invalid_argument("Unknown color pass: " + name);
+	}
+
+	DisplayMode parseDisplayMode(const std::string& name) {
+		if (name == "points") {
+			return DisplayMode::Points;
+		}
+		if (name == "texture") {
+			return DisplayMode::Texture;
+		}
+
+		throw std::invalid_argument("Unknown display mode: " + name);
+	}
+
+	FrameSchedule parseFrameSchedule(const std::string& name) {
+		if (name == "lockstep") {
+			return FrameSchedule::Lockstep;
+		}
+		if (name == "mailbox") {
+			return FrameSchedule::Mailbox;
+		}
+
+		throw std::invalid_argument("Unknown frame schedule: " + name);
+	}
+
+	DownsampleFilter parseDownsampleFilter(const std::string& name) {
+		if (name == "box") {
+			return DownsampleFilter::Box;
+		}
+		if (name == "max") {
+			return DownsampleFilter::Max;
+		}
+
+		throw std::invalid_argument("Unknown downsample filter: " + name);
+	}
+
+	TuningMode parseTuningMode(const std::string& name) {
+		if (name == "cached") {
+			return TuningMode::Cached;
+		}
+		if (name == "search") {
+			return TuningMode::Search;
+		}
+		if (name == "off") {
+			return TuningMode::Off;
+		}
+
+		throw std::invalid_argument("Unknown tuning mode: " + name);
+	}
+
+	const char* convolutionModeName(ConvolutionMode mode) {
+		switch (mode) {
+			case ConvolutionMode::Fft:
+				return "fft";
+			case ConvolutionMode::Separable:
+				return "separable";
+			case ConvolutionMode::Auto:
+				return "auto";
+			default:
+				return "direct";
+		}
+	}
+
+	const char* boundaryModeName(BoundaryMode mode) {
+		return mode == BoundaryMode::Periodic ? "periodic" : "zero";
+	}
+
+	bool parseSimulationArgument(int argc, char** argv, int& index, SimulationConfig& config) {
+		const char* option = argv[index];
+
+		// All the simulation options take exactly one value
+		auto value = [&]() -> std::string {
+			if (index + 1 >= argc) {
+				throw std::invalid_argument(std::string("Missing value for ") + option);
+			}
+			return argv[++index];
+		};
+
+		if (std::strcmp(option, "--backend") == 0) {
+			config.backend = parseBackendType(value());
+		}
+		else if (std::strcmp(option, "--convolution") == 0) {
+			config.convolution = parseConvolutionMode(value());
+		}
+		else if (std::strcmp(option, "--boundary") == 0) {
+			config.boundary = parseBoundaryMode(value());
+		}
+		else if (std::strcmp(option, "--color-pass") == 0) {
+			config.colorPass = parseColorPass(value());
+		}
+		else if (std::strcmp(option, "--display") == 0) {
+			config.display = parseDisplayMode(value());
+		}
+		else if (std::strcmp(option, "--downsample") == 0) {
+			config.downsample = parseDownsampleFilter(value());
+		}
+		else if (std::strcmp(option, "--schedule") == 0) {
+			config.schedule = parseFrameSchedule(value());
+		}
+		else if (std::strcmp(option, "--steps-per-frame") == 0) {
+			config.stepsPerFrame = std::stoi(value());
+		}
+		else if (std::strcmp(option, "--precision") == 0) {
+			config.precision = parsePrecision(value());
+		}
+		else if (std::strcmp(option, "--channels") == 0) {
+			config.channels = std::stoi(value());
+		}
+		else if (std::strcmp(option, "--kernel-radius") == 0) {
+			config.kernelRadius = std::stoi(value());
+		}
+		else if (std::strcmp(option, "--separable-tolerance") == 0) {
+			config.separableTolerance = std::stof(value());
+		}
+		else if (std::strcmp(option, "--batch") == 0) {
+			config.batchSize = std::stoi(value());
+		}
+		else if (std::strcmp(option, "--seed") == 0) {
+			config.seed = std::stoull(value());
+		}
+		else if (std::strcmp(option, "--parameters") == 0) {
+			config.parametersPath = value();
+		}
+		else if (std::strcmp(option, "--threads") == 0) {
+			config.threadCount = std::stoi(value());
+		}
+		else if (std::strcmp(option, "--tile-size") == 0) {
+			config.tileSize = std::stoi(value());
+		}
+		else if (std::strcmp(option, "--world-file") == 0) {
+			config.worldFilePath = value();
+		}
+		else if (std::strcmp(option, "--activity-epsilon") == 0) {
+			config.activityEpsilon = std::stof(value());
+		}
+		else if (std::strcmp(option, "--snapshot-dir") == 0) {
+			config.snapshotDirectory = value();
+		}
+		else if (std::strcmp(option, "--snapshot-interval") == 0) {
+			config.snapshotInterval = std::stoi(value());
+		}
+		else if (std::strcmp(option, "--record") == 0) {
+			config.recordPath = value();
+		}
+		else if (std::strcmp(option, "--trace") == 0) {
+			config.tracePath = value();
+		}
+		else if (std::strcmp(option, "--latency-interval") == 0) {
+			config.latencyInterval = std::stoi(value());
+		}
+		else if (std::strcmp(option, "--latency-report") == 0) {
+			config.latencyReportPath = value();
+		}
+		else if (std::strcmp(option, "--tuning") == 0) {
+			config.tuning = parseTuningMode(value());
+		}
+		else if (std::strcmp(option, "--tuning-db") == 0) {
+			config.tuningDatabasePath = value();
+		}
+		else {
+			return false;
+		}
+
+		return true;
+	}
+
+	const char* simulationArgumentsUsage() {
+		return "[--backend auto|hip|cpu|tiled|out-of-core] [--convolution direct|fft|separable|auto] [--boundary zero|periodic] "
+			"[--color-pass fused|separate] [--display texture|points] [--downsample box|max] [--schedule lockstep|mailbox] [--steps-per-frame N] [--precision fp32|fp16|bf16] [--channels C] [--kernel-radius R] [--separable-tolerance E] [--parameters FILE] [--batch B] [--seed S] [--threads N] [--tile-size T] [--world-file FILE] [--activity-epsilon E] [--snapshot-interval N] [--snapshot-dir DIR] [--record recording.lrec] [--trace trace.json] [--latency-interval S] [--latency-report latency.csv|latency.json] [--tuning cached|search|off] [--tuning-db FILE]";
+	}
+
+	LeniaParameters initialParameters(const SimulationConfig& config) {
+		if (config.parametersPath.empty()) {
+			return defaultParameters(config.channels);
+		}
+		return loadParameters(config.parametersPath);
+	}
+
+	uint64_t initialSeed(const SimulationConfig& config) {
+		if (config.seed != 0) {
+			return config.seed;
+		}
+
+		std::random_device rd;
+		return (static_cast<uint64_t>(rd()) << 32) | rd();
+	}
+
+	void fillRandomState(uint64_t seed, size_t count, float* h_state) {
+		RandomStateStream stream{seed};
+		stream.fill(count, h_state);
+	}
+
+	void RandomStateStream::fill(size_t count, float* h_state) {
+		// NOTE: std::uniform_real_distribution differs between the standard libraries, while the engine is fully specified
+		// the 24 high bits of each value are scaled by hand, so that a seed gives the same state on every build
+		for (size_t i = 0; i < count; i++) {
+			h_state[i] = static_cast<float>(generator() >> 40) * (1.0f / 16777216.0f);
+		}
+	}
+
+	bool isHipBackendAvailable() {
+#ifdef LENIA_ENABLE_HIP
+		// A missing driver is reported as an error, not as zero devices
+		int deviceCount = 0;
+		if (hipGetDeviceCount(&deviceCount) != hipSuccess) {
+			return false;
+		}
+		return deviceCount > 0;
+#else
+		return false;
+#endif
+	}
+
+	void SimulationBackend::streamWorldState(int world, const std::function<void(const float* values, size_t count)>& consume) {
+		std::vector<float> h_state(static_cast<size_t>(channels()) * worldWidth() * worldHeight());
+		readWorldState(world, h_state.data());
+		consume(h_state.data(), h_state.size());
+	}
+
+	std::unique_ptr<SimulationBackend> createSimulationBackend(const SimulationConfig& config, lve::Pixel* templateOutput) {
+		if (config.kernelRadius < 1) {
+			throw std::invalid_argument("The kernel radius must be at least 1");
+		}
+		if (config.channels < 1) {
+			throw std::invalid_argument("The simulation needs at least one channel");
+		}
+		if (config.batchSize < 1) {
+			throw std::invalid_argument("The batch needs at least one world");
+		}
+		if (config.separableTolerance < 0.0f) {
+			throw std::invalid_argument("The separable tolerance can't be negative");
+		}
+		if (config.activityEpsilon < 0.0f) {
+			throw std::invalid_argument("The activity epsilon can't be negative");
+		}
+
+		BackendType backend = config.backend;
+		if (backend == BackendType::Auto) {
+			backend = isHipBackendAvailable() ? BackendType::Hip : BackendType::Cpu;
+		}
+
+		// NOTE: Only a hint for the speed, the other backends step every cell
+		if (config.activityEpsilon > 0.0f && backend != BackendType::Tiled) {
+			fprintf(stderr, "Warning: --activity-epsilon is ignored, only the tiled backend skips the quiescent tiles\n");
+		}
+
+		if (backend == BackendType::Hip) {
+#ifdef LENIA_ENABLE_HIP
+			if (!isHipBackendAvailable()) {
+				throw std::runtime_error("No HIP device available for the simulation");
+			}
+			return std::make_unique<LeniaGraph>(config, templateOutput);
+#else
+			(void)templateOutput;
+			throw std::runtime_error("This build does not include the HIP backend");
+#endif
+		}
+
+		if (backend == BackendType::Tiled) {
+			return std::make_unique<TiledSimulation>(config);
+		}
+		if (backend == BackendType::OutOfCore) {
+			return std::make_unique<OutOfCoreSimulation>(config);
+		}
+
+		return std::make_unique<CpuSimulation>(config);
+	}
+}
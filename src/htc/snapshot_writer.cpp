@@ -0,0 +1,237 @@
+#include "htc/snapshot_writer.hpp"
+#include "htc/checkpoint.hpp"
+#include "htc/trace.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <stdexcept>
+
+#include <zlib.h>
+
+
+// gzwrite takes an unsigned size, the state is written in chunks of this size
+#define SNAPSHOT_WRITE_CHUNK (16u << 20)
+
+
+namespace htc {
+
+	SnapshotWriter::SnapshotWriter(const std::string& directory, const SimulationBackend& simulation, int queueDepth) :
+		directory(directory), streamed(simulation.streamsState()) {
+		if (queueDepth < 1) {
+			throw std::invalid_argument("The snapshot queue needs at least one slot");
+		}
+
+		std::filesystem::create_directories(directory);
+
+		// One buffer per queue slot, plus the one being written
+		stateSize = static_cast<size_t>(simulation.batchSize()) * simulation.channels() * simulation.worldWidth() * simulation.worldHeight();
+		for (int i = 0; i < (streamed ? 0 : queueDepth + 1); i++) {
+			auto snapshot = std::make_unique<Snapshot>();
+			snapshot->state.resize(stateSize);
+			freeSnapshots.push_back(std::move(snapshot));
+		}
+
+		ioThread = std::thread(&SnapshotWriter::io_loop, this);
+	}
+
+	SnapshotWriter::~SnapshotWriter() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			running = false;
+		}
+		queueCondition.notify_all();
+		ioThread.join();
+	}
+
+	bool SnapshotWriter::capture(SimulationBackend& simulation, uint64_t step) {
+		TRACE_SCOPE("capture snapshot");
+
+		if (streamed) {
+			return capture_streamed(simulation, step);
+		}
+
+		auto start = std::chrono::steady_clock::now();
+
+		std::unique_ptr<Snapshot> snapshot;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (freeSnapshots.empty()) {
+				counters.dropped++;
+				return false;
+			}
+			snapshot = std::move(freeSnapshots.back());
+			freeSnapshots.pop_back();
+		}
+
+		// The copy happens outside of the lock, the I/O thread keeps writing meanwhile
+		snapshot->step = step;
+		snapshot->metadata = encodeCheckpointMetadata(simulation, step);
+		simulation.readState(snapshot->state.data());
+
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			queue.push_back(std::move(snapshot));
+			counters.captured++;
+			counters.captureSeconds += elapsed.count();
+			counters.maxQueueDepth = std::max(counters.maxQueueDepth, queue.size());
+		}
+		queueCondition.notify_one();
+
+		return true;
+	}
+
+	bool SnapshotWriter::capture_streamed(SimulationBackend& simulation, uint64_t step) {
+		auto start = std::chrono::steady_clock::now();
+
+		std::vector<char> metadata = encodeCheckpointMetadata(simulation, step);
+		uint64_t compressedBytes = 0;
+		bool success = write_snapshot(step, metadata, [&](const StateSink& sink) {
+			for (int world = 0; world < simulation.batchSize(); world++) {
+				simulation.streamWorldState(world, sink);
+			}
+		}, compressedBytes);
+
+		// The capture is the write, it counts in both
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			counters.captured++;
+			counters.captureSeconds += elapsed.count();
+			counters.writeSeconds += elapsed.count();
+			if (success) {
+				counters.written++;
+				counters.rawBytes += metadata.size() + stateSize * sizeof(float);
+				counters.compressedBytes += compressedBytes;
+			}
+			else {
+				counters.failed++;
+			}
+		}
+
+		return true;
+	}
+
+	void SnapshotWriter::flush() {
+		std::unique_lock<std::mutex> lock(mutex);
+		idleCondition.wait(lock, [this] { return queue.empty() && !writing; });
+	}
+
+	SnapshotStatistics SnapshotWriter::statistics() const {
+		std::lock_guard<std::mutex> lock(mutex);
+		return counters;
+	}
+
+	void SnapshotWriter::printStatistics() const {
+		SnapshotStatistics stats = statistics();
+
+		double ratio = stats.compressedBytes > 0 ? static_cast<double>(stats.rawBytes) / stats.compressedBytes : 0.0;
+		double captureMs = stats.captured > 0 ? 1e3 * stats.captureSeconds / stats.captured : 0.0;
+		double writeMs = stats.written > 0 ? 1e3 * stats.writeSeconds / stats.written : 0.0;
+
+		printf("Snapshots: %llu written, %llu failed, %llu dropped, max queue depth %zu\n",
+			static_cast<unsigned long long>(stats.written), static_cast<unsigned long long>(stats.failed),
+			static_cast<unsigned long long>(stats.dropped), stats.maxQueueDepth);
+		printf("Snapshots: %.3f ms per capture, %.3f ms per write, compression ratio %.2f\n", captureMs, writeMs, ratio);
+	}
+
+	void SnapshotWriter::io_loop() {
+		setTraceThreadName("snapshot writer");
+
+		while (true) {
+			std::unique_ptr<Snapshot> snapshot;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				queueCondition.wait(lock, [this] { return !queue.empty() || !running; });
+
+				// The queued snapshots are still written when stopping
+				if (queue.empty()) {
+					return;
+				}
+				snapshot = std::move(queue.front());
+				queue.pop_front();
+				writing = true;
+			}
+
+			auto start = std::chrono::steady_clock::now();
+			uint64_t compressedBytes = 0;
+			bool success = write_snapshot(snapshot->step, snapshot->metadata, [&](const StateSink& sink) {
+				sink(snapshot->state.data(), snapshot->state.size());
+			}, compressedBytes);
+			std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				if (success) {
+					counters.written++;
+					counters.rawBytes += snapshot->metadata.size() + stateSize * sizeof(float);
+					counters.compressedBytes += compressedBytes;
+				}
+				else {
+					counters.failed++;
+				}
+				counters.writeSeconds += elapsed.count();
+
+				freeSnapshots.push_back(std::move(snapshot));
+				writing = false;
+			}
+			idleCondition.notify_all();
+		}
+	}
+
+	bool SnapshotWriter::write_snapshot(uint64_t step, const std::vector<char>& metadata, const std::function<void(const StateSink&)>& writeState,
+										uint64_t& compressedBytes) {
+		TRACE_SCOPE("write snapshot");
+
+		char name[64];
+		snprintf(name, sizeof(name), "snapshot_%012llu.lenia.gz", static_cast<unsigned long long>(step));
+
+		std::string path = (std::filesystem::path(directory) / name).string();
+		std::string temporaryPath = path + ".tmp";
+
+		// NOTE: Errors are counted rather than thrown, they happen on the I/O thread
+		char mode[] = {'w', 'b', static_cast<char>('0' + SNAPSHOT_COMPRESSION_LEVEL), '\0'};
+		gzFile file = gzopen(temporaryPath.c_str(), mode);
+		if (file == nullptr) {
+			fprintf(stderr, "Failed to open snapshot file: %s\n", temporaryPath.c_str());
+			return false;
+		}
+
+		bool success = gzwrite(file, metadata.data(), static_cast<unsigned>(metadata.size())) == static_cast<int>(metadata.size());
+
+		// A failed read of a streamed state leaves no partial file behind
+		try {
+			writeState([&](const float* values, size_t count) {
+				const char* data = reinterpret_cast<const char*>(values);
+				size_t remaining = count * sizeof(float);
+				while (success && remaining > 0) {
+					unsigned chunk = static_cast<unsigned>(std::min<size_t>(remaining, SNAPSHOT_WRITE_CHUNK));
+					success = gzwrite(file, data, chunk) == static_cast<int>(chunk);
+					data += chunk;
+					remaining -= chunk;
+				}
+			});
+		}
+		catch (...) {
+			gzclose(file);
+			std::remove(temporaryPath.c_str());
+			throw;
+		}
+
+		success = gzclose(file) == Z_OK && success;
+		if (success && std::rename(temporaryPath.c_str(), path.c_str()) != 0) {
+			success = false;
+		}
+		if (!success) {
+			fprintf(stderr, "Failed to write snapshot file: %s\n", path.c_str());
+			std::remove(temporaryPath.c_str());
+			return false;
+		}
+
+		std::error_code error;
+		compressedBytes = std::filesystem::file_size(path, error);
+		return true;
+	}
+}
@@ -0,0 +1,102 @@
+#include "htc/thread_pool.hpp"
+#include "htc/trace.hpp"
+
+#include <algorithm>
+
+
+namespace htc {
+
+	ThreadPool::ThreadPool(int threadCount) : threadCount(threadCount) {
+		if (this->threadCount <= 0) {
+			this->threadCount = std::max(1u, std::thread::hardware_concurrency());
+		}
+
+		// The calling thread is the last member of the pool
+		for (int i = 0; i < this->threadCount - 1; i++) {
+			workers.emplace_back([this, i]() {
+				setTraceThreadName("pool worker " + std::to_string(i + 1));
+				workerLoop();
+			});
+		}
+	}
+
+	ThreadPool::~ThreadPool() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			running = false;
+		}
+		startCondition.notify_all();
+
+		for (std::thread& worker : workers) {
+			worker.join();
+		}
+	}
+
+	void ThreadPool::parallelFor(int count, const std::function<void(int, int)>& body) {
+		if (count <= 0) {
+			return;
+		}
+
+		// Small loops are not worth waking the workers
+		if (workers.empty() || count == 1) {
+			body(0, count);
+			return;
+		}
+
+		{
+			// Publish the job, a few chunks per thread keeps the load balanced
+			std::lock_guard<std::mutex> lock(mutex);
+			job = &body;
+			jobCount = count;
+			chunkSize = std::max(1, count / (threadCount * 4));
+			nextChunk.store(0);
+			pendingWorkers = static_cast<int>(workers.size());
+			generation++;
+		}
+		startCondition.notify_all();
+
+		runChunks();
+
+		// Wait for the workers to finish their last chunk
+		std::unique_lock<std::mutex> lock(mutex);
+		doneCondition.wait(lock, [this]() { return pendingWorkers == 0; });
+		job = nullptr;
+	}
+
+	void ThreadPool::workerLoop() {
+		uint64_t seenGeneration = 0;
+
+		while (true) {
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				startCondition.wait(lock, [&]() { return !running || generation != seenGeneration; });
+				if (!running) {
+					return;
+				}
+				seenGeneration = generation;
+			}
+
+			runChunks();
+
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				if (--pendingWorkers == 0) {
+					doneCondition.notify_one();
+				}
+			}
+		}
+	}
+
+	void ThreadPool::runChunks() {
+		TRACE_SCOPE("parallel for");
+
+		// Grab chunks until the whole range has been distributed
+		while (true) {
+			int begin = nextChunk.fetch_add(chunkSize);
+			if (begin >= jobCount) {
+				break;
+			}
+			(*job)(begin, std::min(begin + chunkSize, jobCount));
+		}
+	}
+}
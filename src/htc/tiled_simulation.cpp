@@ -0,0 +1,653 @@
+#include "htc/tiled_simulation.hpp"
+#include "htc/parameters.hpp"
+#include "htc/display.hpp"
+#include "htc/trace.hpp"
+
+#include "lve/pixel.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+#if defined(__unix__)
+#include <unistd.h>
+#endif
+
+
+// L2 cache size assumed when it can't be queried
+#define DEFAULT_L2_CACHE_SIZE (1024 * 1024)
+
+// Tile sides are multiples of this, so that the rows of the interiors vectorize well
+#define TILE_ALIGNMENT 8
+
+// Smallest tile side picked to give more tiles to the threads, smaller tiles would mostly copy halos
+#define MIN_TILE_SIZE 32
+
+
+namespace htc {
+
+	// L2 cache size of the first core in bytes
+	static size_t l2CacheSize() {
+#if defined(_SC_LEVEL2_CACHE_SIZE)
+		long cacheSize = sysconf(_SC_LEVEL2_CACHE_SIZE);
+		if (cacheSize > 0) {
+			return static_cast<size_t>(cacheSize);
+		}
+#endif
+
+		// Some libc report 0, the kernel exposes the size as e.g. "1024K"
+		std::ifstream file{"/sys/devices/system/cpu/cpu0/cache/index2/size"};
+		size_t size = 0;
+		char unit = 0;
+		if (file >> size) {
+			file >> unit;
+			if (unit == 'K') {
+				size *= 1024;
+			}
+			else if (unit == 'M') {
+				size *= 1024 * 1024;
+			}
+			return size;
+		}
+
+		return DEFAULT_L2_CACHE_SIZE;
+	}
+
+	int defaultTileSize(const SimulationConfig& config, int threadCount) {
+		int radius = config.kernelRadius;
+		int kernelSize = 2 * radius + 1;
+		size_t budget = l2CacheSize() / 2;
+		size_t kernelBytes = static_cast<size_t>(config.channels) * config.channels * kernelSize * kernelSize * sizeof(float);
+
+		// Largest tile whose state with halo and convolution output fit next to the kernels
+		int worldSide = std::max(config.width, config.height);
+		int side = (worldSide + TILE_ALIGNMENT - 1) / TILE_ALIGNMENT * TILE_ALIGNMENT;
+		auto tileBytes = [&](int tileSide) {
+			size_t padded = static_cast<size_t>(tileSide + 2 * radius) * (tileSide + 2 * radius);
+			size_t interior = static_cast<size_t>(tileSide) * tileSide;
+			return config.channels * (padded + interior) * sizeof(float) + kernelBytes;
+		};
+		while (side > TILE_ALIGNMENT && tileBytes(side) > budget) {
+			side -= TILE_ALIGNMENT;
+		}
+
+		// Give at least two tiles to every thread when the world is small
+		auto tileCount = [&](int tileSide) {
+			return static_cast<long>(config.batchSize) * ((config.width + tileSide - 1) / tileSide) * ((config.height + tileSide - 1) / tileSide);
+		};
+		int minSide = std::max(MIN_TILE_SIZE, 2 * radius);
+		while (side - TILE_ALIGNMENT >= minSide && tileCount(side) < 2L * threadCount) {
+			side -= TILE_ALIGNMENT;
+		}
+
+		return side;
+	}
+
+	TiledSimulation::TiledSimulation(const SimulationConfig& config) :
+		threadPool(config.threadCount), width(config.width), height(config.height), depth(config.channels),
+		batch(config.batchSize), kernelRadius(config.kernelRadius), kernelSize(2 * config.kernelRadius + 1),
+		boundary(config.boundary), colorPass(config.colorPass), precision(config.precision),
+		footprint(computeDisplayFootprint({}, config.width, config.height)), leniaParameters(initialParameters(config)),
+		rowKernel(selectDirectRowKernel(config.kernelRadius, config.channels)), activityEpsilon(config.activityEpsilon) {
+
+		// Nothing to tune, the direct convolution is the only one that works on tiles
+		if (config.convolution != ConvolutionMode::Direct && config.convolution != ConvolutionMode::Auto) {
+			throw std::invalid_argument("The tiled backend only supports the direct convolution");
+		}
+		if (config.tileSize < 0) {
+			throw std::invalid_argument("The tile size can't be negative");
+		}
+
+		tileSide = config.tileSize > 0 ? config.tileSize : defaultTileSize(config, threadPool.size());
+		activityReach = (kernelRadius + tileSide - 1) / tileSide;
+		init_tiles();
+
+		// The tiles sized for the L2 cache often cover a whole world, nothing is left to skip
+		if (activityEpsilon > 0.0f && tileRows * tileColumns == 1) {
+			fprintf(stderr, "Warning: --activity-epsilon has no effect, each world is a single %dx%d tile, pass a smaller --tile-size\n",
+				tileSide, tileSide);
+		}
+
+		worldGrowth.assign(batch, leniaParameters.growth);
+		init_kernel(leniaParameters.rings, kernel);
+
+		// Initialize Lenia with random values, each world has its own seed
+		uint64_t seed = initialSeed(config);
+		for (int world = 0; world < batch; world++) {
+			resetWorld(world, seed + world);
+		}
+	}
+
+	void TiledSimulation::init_tiles() {
+		tileColumns = (width + tileSide - 1) / tileSide;
+		tileRows = (height + tileSide - 1) / tileSide;
+
+		size_t stateSize = 0;
+		size_t intermediateSize = 0;
+
+		for (int world = 0; world < batch; world++) {
+			for (int row = 0; row < tileRows; row++) {
+				for (int column = 0; column < tileColumns; column++) {
+					Tile tile;
+					tile.world = world;
+					tile.x = column * tileSide;
+					tile.y = row * tileSide;
+					tile.width = std::min(tileSide, width - tile.x);
+					tile.height = std::min(tileSide, height - tile.y);
+					tile.stateOffset = stateSize;
+					tile.intermediateOffset = intermediateSize;
+
+					stateSize += static_cast<size_t>(depth) * (tile.width + 2 * kernelRadius) * (tile.height + 2 * kernelRadius);
+					intermediateSize += static_cast<size_t>(depth) * tile.width * tile.height;
+
+					tiles.push_back(tile);
+				}
+			}
+		}
+
+		tileStates.resize(stateSize);
+		tileIntermediates.resize(intermediateSize);
+
+		// Every tile is stepped until its first update has measured its activity
+		tileActivity.assign(tiles.size(), std::numeric_limits<float>::infinity());
+		liveTiles.resize(static_cast<size_t>(tileRows) * tileColumns);
+		reachedTiles.resize(static_cast<size_t>(tileRows) * tileColumns);
+	}
+
+	void TiledSimulation::init_kernel(const std::vector<KernelRing>& rings, std::vector<float>& target) const {
+		target.assign(depth * depth * kernelSize * kernelSize, 0.0f);
+		initKernelTensor(depth, kernelRadius, rings, target.data());
+	}
+
+	void TiledSimulation::check_world(int world) const {
+		if (world < 0 || world >= batch) {
+			throw std::out_of_range("World " + std::to_string(world) + " in a batch of " + std::to_string(batch));
+		}
+	}
+
+	const TiledSimulation::Tile& TiledSimulation::tile_at(int world, int x, int y) const {
+		return tiles[(static_cast<size_t>(world) * tileRows + y / tileSide) * tileColumns + x / tileSide];
+	}
+
+	void TiledSimulation::read_row(int world, int channel, int y, int x, int count, float* destination) const {
+		if (boundary == BoundaryMode::Zero && (y < 0 || y >= height)) {
+			std::fill(destination, destination + count, 0.0f);
+			return;
+		}
+		y = ((y % height) + height) % height;
+
+		// Copy the row span by span, each span comes from a single tile or lies outside of the world
+		int done = 0;
+		while (done < count) {
+			int sx = x + done;
+
+			if (sx < 0 || sx >= width) {
+				if (boundary == BoundaryMode::Zero) {
+					int span = sx < 0 ? std::min(count - done, -sx) : count - done;
+					std::fill(destination + done, destination + done + span, 0.0f);
+					done += span;
+					continue;
+				}
+				sx = ((sx % width) + width) % width;
+			}
+
+			const Tile& tile = tile_at(world, sx, y);
+			int localX = sx - tile.x;
+			int localY = y - tile.y;
+			int span = std::min(count - done, tile.width - localX);
+
+			int paddedWidth = tile.width + 2 * kernelRadius;
+			int paddedHeight = tile.height + 2 * kernelRadius;
+			const float* source = &tileStates[tile.stateOffset + (static_cast<size_t>(channel) * paddedHeight + localY + kernelRadius) * paddedWidth + localX + kernelRadius];
+
+			std::copy(source, source + span, destination + done);
+			done += span;
+		}
+	}
+
+	bool TiledSimulation::world_can_sleep(int world) const {
+		if (activityEpsilon <= 0.0f) {
+			return false;
+		}
+
+		// Without any potential, the cells move towards the growth of a zero potential, it must stay negligible
+		// NOTE: Otherwise the empty regions of the world come alive and no tile can be skipped
+		const GrowthParameters& growth = worldGrowth[world];
+		float normalized = growth.mu / growth.sigma;
+		return expf(-normalized * normalized) <= activityEpsilon;
+	}
+
+	void TiledSimulation::mark_world_active(int world) {
+		int tilesPerWorld = tileRows * tileColumns;
+		std::fill(tileActivity.begin() + static_cast<size_t>(world) * tilesPerWorld,
+			tileActivity.begin() + static_cast<size_t>(world + 1) * tilesPerWorld, std::numeric_limits<float>::infinity());
+	}
+
+	void TiledSimulation::select_active_tiles() {
+		activeTiles.clear();
+		inactiveTiles.clear();
+
+		int tilesPerWorld = tileRows * tileColumns;
+		for (int world = 0; world < batch; world++) {
+			int firstTile = world * tilesPerWorld;
+
+			if (!world_can_sleep(world)) {
+				for (int index = firstTile; index < firstTile + tilesPerWorld; index++) {
+					activeTiles.push_back(index);
+				}
+				continue;
+			}
+
+			for (int index = 0; index < tilesPerWorld; index++) {
+				liveTiles[index] = tileActivity[firstTile + index] > activityEpsilon;
+			}
+
+			// Spread the live tiles over the reach of the kernel, along the rows then along the columns
+			// NOTE: The reach wraps around the world with periodic boundaries
+			auto spread = [&](const std::vector<char>& source, std::vector<char>& destination, bool alongRows) {
+				int length = alongRows ? tileColumns : tileRows;
+				for (int row = 0; row < tileRows; row++) {
+					for (int column = 0; column < tileColumns; column++) {
+						int position = alongRows ? column : row;
+						char reached = 0;
+
+						for (int offset = -activityReach; offset <= activityReach && !reached; offset++) {
+							int neighbour = position + offset;
+							if (neighbour < 0 || neighbour >= length) {
+								if (boundary == BoundaryMode::Zero) {
+									continue;
+								}
+								neighbour = ((neighbour % length) + length) % length;
+							}
+							reached = alongRows ? source[row * tileColumns + neighbour] : source[neighbour * tileColumns + column];
+						}
+						destination[row * tileColumns + column] = reached;
+					}
+				}
+			};
+			spread(liveTiles, reachedTiles, true);
+			spread(reachedTiles, liveTiles, false);
+
+			for (int index = 0; index < tilesPerWorld; index++) {
+				(liveTiles[index] ? activeTiles : inactiveTiles).push_back(firstTile + index);
+			}
+		}
+
+		lastActiveFraction = static_cast<double>(activeTiles.size()) / tiles.size();
+	}
+
+	void TiledSimulation::exchange_halos() {
+		// Each active tile fills its own halo from the interiors of its neighbours, which are not written meanwhile
+		threadPool.parallelFor(static_cast<int>(activeTiles.size()), [&](int begin, int end) {
+			for (int i = begin; i < end; i++) {
+				const Tile& tile = tiles[activeTiles[i]];
+				int paddedWidth = tile.width + 2 * kernelRadius;
+				int paddedHeight = tile.height + 2 * kernelRadius;
+
+				for (int channel = 0; channel < depth; channel++) {
+					for (int py = 0; py < paddedHeight; py++) {
+						float* row = &tileStates[tile.stateOffset + (static_cast<size_t>(channel) * paddedHeight + py) * paddedWidth];
+						int sy = tile.y + py - kernelRadius;
+
+						// The top and bottom bands are entirely halo, the other rows only on their sides
+						if (py < kernelRadius || py >= kernelRadius + tile.height) {
+							read_row(tile.world, channel, sy, tile.x - kernelRadius, paddedWidth, row);
+						}
+						else {
+							read_row(tile.world, channel, sy, tile.x - kernelRadius, kernelRadius, row);
+							read_row(tile.world, channel, sy, tile.x + tile.width, kernelRadius, row + kernelRadius + tile.width);
+						}
+					}
+				}
+			}
+		});
+	}
+
+	void TiledSimulation::convolve_tile(const Tile& tile) {
+		int paddedWidth = tile.width + 2 * kernelRadius;
+		int paddedHeight = tile.height + 2 * kernelRadius;
+		const float* padded = &tileStates[tile.stateOffset];
+		float* output = &tileIntermediates[tile.intermediateOffset];
+
+		// Same row kernel as DirectConvolution, so that the sums are rounded the same way
+		for (int target = 0; target < depth; target++) {
+			for (int y = 0; y < tile.height; y++) {
+				rowKernel(kernel.data(), padded, paddedWidth, paddedHeight, tile.width, depth, kernelRadius,
+					target, y, &output[(target * tile.height + y) * tile.width]);
+			}
+		}
+
+		roundToPrecision(precision, output, static_cast<size_t>(depth) * tile.width * tile.height);
+	}
+
+	void TiledSimulation::update_tile(const Tile& tile, lve::Pixel* worldOutput) {
+		int paddedWidth = tile.width + 2 * kernelRadius;
+		int paddedHeight = tile.height + 2 * kernelRadius;
+		const GrowthParameters& growth = worldGrowth[tile.world];
+
+		// Only the first world is colored
+		lve::Pixel* output = tile.world == 0 ? worldOutput : nullptr;
+
+		// Largest value and largest change of the tile, for the sparse stepping
+		float peak = 0.0f;
+		float change = 0.0f;
+
+		for (int y = 0; y < tile.height; y++) {
+			int worldY = tile.y + y;
+
+			for (int z = 0; z < depth; z++) {
+				float* stateRow = &tileStates[tile.stateOffset + (static_cast<size_t>(z) * paddedHeight + y + kernelRadius) * paddedWidth + kernelRadius];
+				const float* intermediateRow = &tileIntermediates[tile.intermediateOffset + (static_cast<size_t>(z) * tile.height + y) * tile.width];
+
+				for (int x = 0; x < tile.width; x++) {
+					float normalized = (intermediateRow[x] - growth.mu) / growth.sigma;
+					float t = expf(-normalized * normalized);
+
+					float updated = (1 - growth.timeStep) * stateRow[x] + growth.timeStep * t;
+					change = std::max(change, std::fabs(updated - stateRow[x]));
+					peak = std::max(peak, updated);
+					stateRow[x] = updated;
+				}
+				roundToPrecision(precision, stateRow, tile.width);
+
+				if (output == nullptr || z >= 3) {
+					continue;
+				}
+
+				lve::Pixel* outputRow = output + worldY * width + tile.x;
+				for (int x = 0; x < tile.width; x++) {
+					if (z == 0) {
+						// The missing channels are black
+						writeCell(outputRow[x], stateRow[x], 0.0f, 0.0f);
+					}
+					else {
+						writeChannel(outputRow[x], z, stateRow[x]);
+					}
+				}
+			}
+		}
+
+		tileActivity[&tile - tiles.data()] = std::max(peak, change);
+	}
+
+	void TiledSimulation::color_tile(const Tile& tile, lve::Pixel* output) const {
+		int paddedWidth = tile.width + 2 * kernelRadius;
+		int paddedHeight = tile.height + 2 * kernelRadius;
+
+		for (int y = 0; y < tile.height; y++) {
+			const float* stateRows[3] = { nullptr, nullptr, nullptr };
+			for (int z = 0; z < std::min(depth, 3); z++) {
+				stateRows[z] = &tileStates[tile.stateOffset + (static_cast<size_t>(z) * paddedHeight + y + kernelRadius) * paddedWidth + kernelRadius];
+			}
+
+			lve::Pixel* outputRow = output + (tile.y + y) * width + tile.x;
+			for (int x = 0; x < tile.width; x++) {
+				// The missing channels are black
+				writeCell(outputRow[x],
+					stateRows[0] != nullptr ? stateRows[0][x] : 0.0f,
+					stateRows[1] != nullptr ? stateRows[1][x] : 0.0f,
+					stateRows[2] != nullptr ? stateRows[2][x] : 0.0f);
+			}
+		}
+	}
+
+	void TiledSimulation::color_inactive_tiles(lve::Pixel* output) {
+		// The output may be a buffer of an older frame, the skipped tiles of the first world are colored again
+		// NOTE: The tiles of the first world come first
+		int count = 0;
+		while (count < static_cast<int>(inactiveTiles.size()) && tiles[inactiveTiles[count]].world == 0) {
+			count++;
+		}
+
+		threadPool.parallelFor(count, [&](int begin, int end) {
+			for (int i = begin; i < end; i++) {
+				color_tile(tiles[inactiveTiles[i]], output);
+			}
+		});
+	}
+
+	void TiledSimulation::color_view(lve::Pixel* output) {
+		// The rows are gathered from the interiors of the tiles, whether they were stepped or not
+		threadPool.parallelFor(footprint.height, [&](int begin, int end) {
+			std::vector<float> cells;
+			colorViewRows(footprint, depth, begin, end, output, [&](int z, int y, int x, int count) {
+				cells.resize(count);
+				read_row(0, z, y, x, count, cells.data());
+				return cells.data();
+			});
+		});
+	}
+
+	void TiledSimulation::setDisplayView(const DisplayView& view) {
+		footprint = computeDisplayFootprint(view, width, height);
+	}
+
+	void TiledSimulation::runConvolution() {
+		TRACE_SCOPE("convolution");
+
+		// The update that follows steps the same tiles
+		select_active_tiles();
+		exchange_halos();
+
+		threadPool.parallelFor(static_cast<int>(activeTiles.size()), [&](int begin, int end) {
+			for (int i = begin; i < end; i++) {
+				convolve_tile(tiles[activeTiles[i]]);
+			}
+		});
+	}
+
+	void TiledSimulation::runUpdate() {
+		TRACE_SCOPE("update");
+
+		threadPool.parallelFor(static_cast<int>(activeTiles.size()), [&](int begin, int end) {
+			for (int i = begin; i < end; i++) {
+				update_tile(tiles[activeTiles[i]], nullptr);
+			}
+		});
+	}
+
+	void TiledSimulation::runColor(lve::Pixel* output) {
+		TRACE_SCOPE("color");
+
+		if (!footprint.direct) {
+			color_view(output);
+			return;
+		}
+
+		// The tiles of the first world come first
+		threadPool.parallelFor(tileRows * tileColumns, [&](int begin, int end) {
+			for (int index = begin; index < end; index++) {
+				color_tile(tiles[index], output);
+			}
+		});
+	}
+
+	void TiledSimulation::runUpdateColor(lve::Pixel* output) {
+		TRACE_SCOPE("update+color");
+
+		// The pixels of a view cover several cells, they are colored once all of them are updated
+		lve::Pixel* tileOutput = footprint.direct ? output : nullptr;
+		threadPool.parallelFor(static_cast<int>(activeTiles.size()), [&](int begin, int end) {
+			for (int i = begin; i < end; i++) {
+				update_tile(tiles[activeTiles[i]], tileOutput);
+			}
+		});
+
+		if (footprint.direct) {
+			color_inactive_tiles(output);
+		}
+		else {
+			color_view(output);
+		}
+	}
+
+	void TiledSimulation::step(lve::Pixel* output) {
+		TRACE_SCOPE("step");
+
+		// All the halos must be refreshed before any interior is updated
+		select_active_tiles();
+		exchange_halos();
+
+		// Then each tile is convolved and updated in one go, while it is still in cache
+		lve::Pixel* fusedOutput = colorPass == ColorPass::Fused && footprint.direct ? output : nullptr;
+		threadPool.parallelFor(static_cast<int>(activeTiles.size()), [&](int begin, int end) {
+			for (int i = begin; i < end; i++) {
+				convolve_tile(tiles[activeTiles[i]]);
+				update_tile(tiles[activeTiles[i]], fusedOutput);
+			}
+		});
+		if (fusedOutput != nullptr) {
+			color_inactive_tiles(fusedOutput);
+		}
+
+		if (output != nullptr && fusedOutput == nullptr) {
+			runColor(output);
+		}
+	}
+
+	void TiledSimulation::setParameters(const LeniaParameters& parameters) {
+		// Build the new kernels first, so that invalid parameters leave the simulation unchanged
+		std::vector<float> newKernel;
+		init_kernel(parameters.rings, newKernel);
+
+		kernel = std::move(newKernel);
+		leniaParameters = parameters;
+		worldGrowth.assign(batch, parameters.growth);
+
+		// A quiescent tile may come alive with the new parameters
+		std::fill(tileActivity.begin(), tileActivity.end(), std::numeric_limits<float>::infinity());
+	}
+
+	void TiledSimulation::setWorldGrowth(int world, const GrowthParameters& growth) {
+		check_world(world);
+		worldGrowth[world] = growth;
+		mark_world_active(world);
+	}
+
+	const GrowthParameters& TiledSimulation::growth(int world) const {
+		check_world(world);
+		return worldGrowth[world];
+	}
+
+	void TiledSimulation::resetWorld(int world, uint64_t seed) {
+		check_world(world);
+
+		// Same random state as the other backends, then split into the tiles
+		size_t worldSize = static_cast<size_t>(width) * height * depth;
+		std::vector<float> h_state(worldSize);
+		fillRandomState(seed, worldSize, h_state.data());
+		roundToPrecision(precision, h_state.data(), worldSize);
+
+		scatter_world(world, h_state.data());
+	}
+
+	void TiledSimulation::writeWorldState(int world, const float* h_state) {
+		check_world(world);
+
+		if (precision == Precision::Float32) {
+			scatter_world(world, h_state);
+			return;
+		}
+
+		// The input can't be rounded in place
+		size_t worldSize = static_cast<size_t>(width) * height * depth;
+		std::vector<float> rounded(h_state, h_state + worldSize);
+		roundToPrecision(precision, rounded.data(), worldSize);
+		scatter_world(world, rounded.data());
+	}
+
+	void TiledSimulation::gather_worlds(int firstWorld, int worldCount, float* h_state) {
+		int tilesPerWorld = tileRows * tileColumns;
+		const Tile* firstTile = &tiles[static_cast<size_t>(firstWorld) * tilesPerWorld];
+
+		threadPool.parallelFor(worldCount * tilesPerWorld, [&](int begin, int end) {
+			for (int index = begin; index < end; index++) {
+				const Tile& tile = firstTile[index];
+				int paddedWidth = tile.width + 2 * kernelRadius;
+				int paddedHeight = tile.height + 2 * kernelRadius;
+
+				for (int z = 0; z < depth; z++) {
+					for (int y = 0; y < tile.height; y++) {
+						const float* source = &tileStates[tile.stateOffset + (static_cast<size_t>(z) * paddedHeight + y + kernelRadius) * paddedWidth + kernelRadius];
+						float* destination = &h_state[((static_cast<size_t>(tile.world - firstWorld) * depth + z) * height + tile.y + y) * width + tile.x];
+						std::copy(source, source + tile.width, destination);
+					}
+				}
+			}
+		});
+	}
+
+	void TiledSimulation::scatter_world(int world, const float* h_state) {
+		int tilesPerWorld = tileRows * tileColumns;
+		Tile* firstTile = &tiles[static_cast<size_t>(world) * tilesPerWorld];
+
+		// Only the interiors are written, the halos are refreshed by the next step
+		mark_world_active(world);
+		threadPool.parallelFor(tilesPerWorld, [&](int begin, int end) {
+			for (int index = begin; index < end; index++) {
+				const Tile& tile = firstTile[index];
+				int paddedWidth = tile.width + 2 * kernelRadius;
+				int paddedHeight = tile.height + 2 * kernelRadius;
+
+				for (int z = 0; z < depth; z++) {
+					for (int y = 0; y < tile.height; y++) {
+						const float* source = &h_state[(static_cast<size_t>(z) * height + tile.y + y) * width + tile.x];
+						float* destination = &tileStates[tile.stateOffset + (static_cast<size_t>(z) * paddedHeight + y + kernelRadius) * paddedWidth + kernelRadius];
+						std::copy(source, source + tile.width, destination);
+					}
+				}
+			}
+		});
+	}
+
+	void TiledSimulation::readState(float* h_state) {
+		gather_worlds(0, batch, h_state);
+	}
+
+	void TiledSimulation::readWorldState(int world, float* h_state) {
+		check_world(world);
+		gather_worlds(world, 1, h_state);
+	}
+
+	std::vector<WorldMetrics> TiledSimulation::readMetrics() {
+		std::vector<WorldMetrics> metrics(batch);
+		for (WorldMetrics& world : metrics) {
+			world.mass.resize(depth);
+			world.maximum.resize(depth);
+		}
+
+		// One task per plane, walking the tiles of its world, the sums are accumulated in double precision
+		int tilesPerWorld = tileRows * tileColumns;
+		threadPool.parallelFor(batch * depth, [&](int begin, int end) {
+			for (int plane = begin; plane < end; plane++) {
+				int world = plane / depth;
+				int z = plane % depth;
+
+				double mass = 0.0;
+				float maximum = 0.0f;
+				for (int index = world * tilesPerWorld; index < (world + 1) * tilesPerWorld; index++) {
+					const Tile& tile = tiles[index];
+					int paddedWidth = tile.width + 2 * kernelRadius;
+					int paddedHeight = tile.height + 2 * kernelRadius;
+
+					for (int y = 0; y < tile.height; y++) {
+						const float* values = &tileStates[tile.stateOffset + (static_cast<size_t>(z) * paddedHeight + y + kernelRadius) * paddedWidth + kernelRadius];
+						for (int x = 0; x < tile.width; x++) {
+							mass += values[x];
+							maximum = std::max(maximum, values[x]);
+						}
+					}
+				}
+
+				metrics[world].mass[z] = static_cast<float>(mass);
+				metrics[world].maximum[z] = maximum;
+			}
+		});
+
+		return metrics;
+	}
+}
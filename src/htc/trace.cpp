@@ -0,0 +1,151 @@
+#include "htc/trace.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+
+namespace htc {
+
+	std::atomic<bool> traceEnabled{false};
+
+	struct TraceEvent {
+		const char* name;
+		int64_t start;
+		int64_t duration;
+	};
+
+	// Ring of the events of one thread, only written by that thread
+	struct TraceBuffer {
+		uint32_t threadId;
+		std::string threadName;
+		std::vector<TraceEvent> events;
+		std::atomic<uint64_t> count{0};
+	};
+
+	// The buffers outlive their threads, so that the events of the finished threads are still written
+	static std::mutex registryMutex;
+	static std::vector<std::unique_ptr<TraceBuffer>> registry;
+
+	static thread_local TraceBuffer* threadBuffer = nullptr;
+	static thread_local std::string threadName;
+
+	static TraceBuffer* threadTraceBuffer() {
+		if (threadBuffer == nullptr) {
+			auto buffer = std::make_unique<TraceBuffer>();
+			buffer->events.resize(TRACE_BUFFER_EVENTS);
+
+			std::lock_guard<std::mutex> lock(registryMutex);
+			buffer->threadId = static_cast<uint32_t>(registry.size()) + 1;
+			buffer->threadName = threadName;
+			threadBuffer = buffer.get();
+			registry.push_back(std::move(buffer));
+		}
+		return threadBuffer;
+	}
+
+	// Names are string literals, only the characters that break the JSON are replaced
+	static std::string escapeJson(const std::string& text) {
+		std::string escaped;
+		for (char c : text) {
+			if (c == '"' || c == '\\') {
+				escaped += '\\';
+			}
+			escaped += static_cast<unsigned char>(c) < 0x20 ? ' ' : c;
+		}
+		return escaped;
+	}
+
+	void setTracingEnabled(bool enabled) {
+		traceEnabled.store(enabled);
+	}
+
+	void setTraceThreadName(const std::string& name) {
+		// The ring is only allocated by the first event, the threads that never record cost nothing
+		threadName = name;
+		if (threadBuffer != nullptr) {
+			std::lock_guard<std::mutex> lock(registryMutex);
+			threadBuffer->threadName = name;
+		}
+	}
+
+	int64_t traceClock() {
+		auto now = std::chrono::steady_clock::now().time_since_epoch();
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+	}
+
+	void recordTraceEvent(const char* name, int64_t start, int64_t end) {
+		TraceBuffer* buffer = threadTraceBuffer();
+
+		uint64_t index = buffer->count.load(std::memory_order_relaxed);
+		buffer->events[index % TRACE_BUFFER_EVENTS] = {name, start, end - start};
+		buffer->count.store(index + 1, std::memory_order_release);
+	}
+
+	void writeTrace(const std::string& path) {
+		// Copy the last events of each thread first, the file is written without holding the lock
+		struct ThreadEvents {
+			uint32_t threadId;
+			std::string threadName;
+			std::vector<TraceEvent> events;
+		};
+		std::vector<ThreadEvents> threads;
+		{
+			std::lock_guard<std::mutex> lock(registryMutex);
+			for (const std::unique_ptr<TraceBuffer>& buffer : registry) {
+				uint64_t count = buffer->count.load(std::memory_order_acquire);
+				uint64_t first = count > TRACE_BUFFER_EVENTS ? count - TRACE_BUFFER_EVENTS : 0;
+
+				ThreadEvents thread{buffer->threadId, buffer->threadName, {}};
+				for (uint64_t i = first; i < count; i++) {
+					thread.events.push_back(buffer->events[i % TRACE_BUFFER_EVENTS]);
+				}
+				threads.push_back(std::move(thread));
+			}
+		}
+
+		// Timestamps are relative to the first event, in microseconds
+		int64_t origin = INT64_MAX;
+		for (const ThreadEvents& thread : threads) {
+			for (const TraceEvent& event : thread.events) {
+				origin = std::min(origin, event.start);
+			}
+		}
+
+		std::ofstream file{path};
+		if (!file.is_open()) {
+			throw std::runtime_error("failed to open file: " + path);
+		}
+
+		file << std::fixed << std::setprecision(3);
+		file << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+		bool first = true;
+		auto separator = [&]() {
+			file << (first ? "" : ",\n");
+			first = false;
+		};
+
+		for (const ThreadEvents& thread : threads) {
+			std::string threadName = thread.threadName.empty() ? "thread " + std::to_string(thread.threadId) : thread.threadName;
+			separator();
+			file << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << thread.threadId
+				<< ", \"args\": {\"name\": \"" << escapeJson(threadName) << "\"}}";
+
+			for (const TraceEvent& event : thread.events) {
+				separator();
+				file << "{\"name\": \"" << escapeJson(event.name) << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << thread.threadId
+					<< ", \"ts\": " << (event.start - origin) / 1e3 << ", \"dur\": " << event.duration / 1e3 << "}";
+			}
+		}
+
+		file << "\n]}\n";
+		if (!file) {
+			throw std::runtime_error("failed to write file: " + path);
+		}
+	}
+}
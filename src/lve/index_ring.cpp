@@ -0,0 +1,107 @@
+#include "lve/index_ring.hpp"
+
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+
+
+namespace lve {
+
+	// Hint to the CPU that the thread is spinning
+	static inline void spinPause() {
+#if defined(__x86_64__) || defined(__i386__)
+		__builtin_ia32_pause();
+#else
+		std::this_thread::yield();
+#endif
+	}
+
+	LveIndexRing::LveIndexRing(uint32_t capacity, uint32_t spinCount) : slots(capacity), spinCount{spinCount} {
+		if (capacity == 0) {
+			throw std::invalid_argument("An index ring needs at least one slot");
+		}
+
+		// Spinning only delays the other thread when both share a single core
+		if (std::thread::hardware_concurrency() < 2) {
+			this->spinCount = 0;
+		}
+	}
+
+	void LveIndexRing::push(uint32_t index) {
+		uint64_t currentTail = tail.load(std::memory_order_relaxed);
+		if (currentTail - head.load(std::memory_order_acquire) >= slots.size()) {
+			throw std::logic_error("index ring overflow");
+		}
+
+		slots[currentTail % slots.size()] = index;
+
+		// Publish the slot, then check for a parked consumer
+		// NOTE: Both sides use sequentially consistent operations on tail and parked, so that either the consumer
+		// sees the new index before parking, or the producer sees it parked and wakes it up
+		tail.store(currentTail + 1, std::memory_order_seq_cst);
+		if (parked.load(std::memory_order_seq_cst)) {
+			wake_consumer();
+		}
+	}
+
+	bool LveIndexRing::tryPop(uint32_t& index) {
+		uint64_t currentHead = head.load(std::memory_order_relaxed);
+		if (currentHead == tail.load(std::memory_order_acquire)) {
+			return false;
+		}
+
+		index = slots[currentHead % slots.size()];
+		head.store(currentHead + 1, std::memory_order_release);
+		return true;
+	}
+
+	bool LveIndexRing::pop(uint32_t& index) {
+		// Fast path, nothing is measured
+		if (tryPop(index)) {
+			return true;
+		}
+
+		auto start = std::chrono::steady_clock::now();
+		waitStatistics.waits++;
+
+		bool popped = false;
+		for (uint32_t i = 0; i < spinCount && !closed.load(std::memory_order_relaxed); i++) {
+			if (tryPop(index)) {
+				popped = true;
+				break;
+			}
+			spinPause();
+		}
+
+		if (!popped) {
+			waitStatistics.parks++;
+
+			std::unique_lock<std::mutex> lock(parkMutex);
+			parked.store(true, std::memory_order_seq_cst);
+			parkCondition.wait(lock, [&]() {
+				return tail.load(std::memory_order_seq_cst) != head.load(std::memory_order_relaxed) || closed.load();
+			});
+			parked.store(false, std::memory_order_relaxed);
+
+			popped = tryPop(index);
+		}
+
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+		waitStatistics.waitSeconds += elapsed.count();
+
+		return popped;
+	}
+
+	void LveIndexRing::close() {
+		closed.store(true);
+		wake_consumer();
+	}
+
+	void LveIndexRing::wake_consumer() {
+		// Taking the mutex guarantees that the consumer is either waiting or has not checked its predicate yet
+		{
+			std::lock_guard<std::mutex> lock(parkMutex);
+		}
+		parkCondition.notify_one();
+	}
+}
\ No newline at end of file
@@ -1,25 +1,72 @@
 #include "lve/multiple_vertex_buffer.hpp"
 
+#include "htc/trace.hpp"
+
 #include <cstring>
 #include <cassert>
+#include <stdio.h>
 
 
 namespace lve {
 
-	LveMultipleVertexBuffer::LveMultipleVertexBuffer(LveDevice& device, std::vector<VkBuffer> vertexBuffers, uint32_t vertexBufferCount, uint32_t vertexCount) :
-	lveDevice{device}, vertexBuffers{vertexBuffers}, vertexBufferCount{vertexBufferCount}, vertexCount{vertexCount} {
+	LveMultipleVertexBuffer::LveMultipleVertexBuffer(LveDevice& device, std::vector<VkBuffer> vertexBuffers, uint32_t vertexBufferCount, const std::vector<Position>& positions,
+														bool mailbox, uint32_t spinCount) :
+	lveDevice{device}, vertexBuffers{vertexBuffers}, vertexBufferCount{vertexBufferCount}, vertexCount{static_cast<uint32_t>(positions.size())},
+	readBuffers{vertexBufferCount, spinCount}, writeBuffers{vertexBufferCount, spinCount}, mailbox{mailbox}, publishTimes(vertexBufferCount, 0), lastFrameUsed(vertexBufferCount, 0) {
+		// All the buffers can be written at first
 		for (uint32_t i = 0; i < vertexBufferCount; i++) {
-			availableWriteBuffers.push_back(i);
+			writeBuffers.push(i);
+		}
+
+		if (!positions.empty()) {
+			createPositionBuffer(positions);
+		}
+	}
+
+	LveMultipleVertexBuffer::~LveMultipleVertexBuffer() {
+		if (positionBuffer != VK_NULL_HANDLE) {
+			vkDestroyBuffer(lveDevice.device(), positionBuffer, nullptr);
+			vkFreeMemory(lveDevice.device(), positionBufferMemory, nullptr);
 		}
 	}
 
-	LveMultipleVertexBuffer::~LveMultipleVertexBuffer() {}
+	void LveMultipleVertexBuffer::createPositionBuffer(const std::vector<Position>& positions) {
+		VkDeviceSize bufferSize = sizeof(Position) * positions.size();
+
+		// Upload the positions once through a staging buffer
+		VkBuffer stagingBuffer;
+		VkDeviceMemory stagingBufferMemory;
+		lveDevice.createBuffer(
+			bufferSize,
+			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			stagingBuffer,
+			stagingBufferMemory
+		);
+
+		void* data;
+		vkMapMemory(lveDevice.device(), stagingBufferMemory, 0, bufferSize, 0, &data);
+		memcpy(data, positions.data(), static_cast<size_t>(bufferSize));
+		vkUnmapMemory(lveDevice.device(), stagingBufferMemory);
+
+		lveDevice.createBuffer(
+			bufferSize,
+			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			positionBuffer,
+			positionBufferMemory
+		);
+		lveDevice.copyBuffer(stagingBuffer, positionBuffer, bufferSize);
+
+		vkDestroyBuffer(lveDevice.device(), stagingBuffer, nullptr);
+		vkFreeMemory(lveDevice.device(), stagingBufferMemory, nullptr);
+	}
 
 	void LveMultipleVertexBuffer::bind(VkCommandBuffer commandBuffer, int vertexBufferIndex) {
-		// Bind the vertex buffer to the command buffer
-		VkBuffer buffers[] = {vertexBuffers[vertexBufferIndex]};
-		VkDeviceSize offsets[] = {0};
-		vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
+		// Bind the static positions and the colors of the frame to the command buffer
+		VkBuffer buffers[] = {positionBuffer, vertexBuffers[vertexBufferIndex]};
+		VkDeviceSize offsets[] = {0, 0};
+		vkCmdBindVertexBuffers(commandBuffer, 0, 2, buffers, offsets);
 	}
 
 	void LveMultipleVertexBuffer::draw(VkCommandBuffer commandBuffer) {
@@ -27,76 +74,100 @@ namespace lve {
 		vkCmdDraw(commandBuffer, vertexCount, 1, 0, 0);
 	}
 
-	uint32_t LveMultipleVertexBuffer::getAvailableReadBuffer() {
-		uint32_t readBufferIndex;
-
-		{
-			std::unique_lock<std::mutex> lock(readMutex);
+	bool LveMultipleVertexBuffer::getAvailableReadBuffer(uint32_t& bufferIndex) {
+		uint32_t newBuffer;
 
-			// Wait until there is a read buffer available
-			if (availableReadBuffers.empty()) {
-				readCondition.wait(lock, [this]() { return !availableReadBuffers.empty() || !running; });
-				if (!running) {
-					return 0;
-				}
+		if (mailbox) {
+			// Take the newest frame if there is one, otherwise show the same buffer again
+			newBuffer = latestFrame.exchange(NO_BUFFER, std::memory_order_acq_rel);
+			if (newBuffer == NO_BUFFER && shownBuffer == NO_BUFFER) {
+				return false;
+			}
+		}
+		else {
+			// Wait until there is a read buffer available, or until the program exits
+			if (!readBuffers.pop(newBuffer)) {
+				return false;
 			}
-
-			// Get the read buffer index
-			readBufferIndex = availableReadBuffers.front();
-			availableReadBuffers.pop_front();
 		}
 
-		return readBufferIndex;
-	}
+		// The previous buffer may still be read by the frames in flight
+		if (newBuffer != NO_BUFFER) {
+			handoffHistogram.record(htc::traceClock() - publishTimes[newBuffer]);
 
-	uint32_t LveMultipleVertexBuffer::getAvailableWriteBuffer() {
-		uint32_t writeBufferIndex;
-		
-		{
-			std::unique_lock<std::mutex> lock(writeMutex);
-
-			// Wait until there is a write buffer available
-			if (availableWriteBuffers.empty()) {
-				writeCondition.wait(lock, [this]() { return !availableWriteBuffers.empty() || !running; });
-				if (!running) {
-					return 0;
-				}
+			if (shownBuffer != NO_BUFFER) {
+				retiredBuffers.push_back(shownBuffer);
 			}
+			shownBuffer = newBuffer;
+		}
+
+		lastFrameUsed[shownBuffer] = frameCount++;
+		bufferIndex = shownBuffer;
+		return true;
+	}
 
-			// Get the write buffer index
-			writeBufferIndex = availableWriteBuffers.front();
-			availableWriteBuffers.pop_front();
+	bool LveMultipleVertexBuffer::getAvailableWriteBuffer(uint32_t& bufferIndex) {
+		// A frame replaced in the mailbox was never shown, it can be written again right away
+		if (spareBuffer != NO_BUFFER) {
+			bufferIndex = spareBuffer;
+			spareBuffer = NO_BUFFER;
+			return true;
 		}
 
-		return writeBufferIndex;
+		// Wait until there is a write buffer available, or until the program exits
+		return writeBuffers.pop(bufferIndex);
 	}
 
 	void LveMultipleVertexBuffer::setReadBufferAvailable(uint32_t bufferIndex) {
-		{
-			// Add the read buffer index to the available read buffers
-			std::unique_lock<std::mutex> lock(readMutex);
-			availableReadBuffers.push_back(bufferIndex);
+		// Published with the index, the ring and the mailbox both release it to the render pass
+		publishTimes[bufferIndex] = htc::traceClock();
+
+		if (!mailbox) {
+			// Hand the buffer to the render pass, waking it up if it sleeps
+			readBuffers.push(bufferIndex);
+			return;
+		}
+
+		// Replace the frame waiting to be shown, if any
+		uint32_t replacedBuffer = latestFrame.exchange(bufferIndex, std::memory_order_acq_rel);
+		if (replacedBuffer != NO_BUFFER) {
+			spareBuffer = replacedBuffer;
+			droppedFrameCount.fetch_add(1, std::memory_order_relaxed);
 		}
-		// Notify the waiting threads that a read buffer is available
-		readCondition.notify_one();
 	}
 
-	void LveMultipleVertexBuffer::setWriteBufferAvailable(uint32_t bufferIndex) {
-		{
-			// Add the write buffer index to the available write buffers
-			std::unique_lock<std::mutex> lock(writeMutex);
-			availableWriteBuffers.push_back(bufferIndex);
+	void LveMultipleVertexBuffer::releaseCompletedBuffers(uint32_t framesInFlight) {
+		// Hand the retired buffers whose last frame is complete back to the generation pass
+		auto retired = retiredBuffers.begin();
+		while (retired != retiredBuffers.end()) {
+			if (lastFrameUsed[*retired] + framesInFlight < frameCount) {
+				writeBuffers.push(*retired);
+				retired = retiredBuffers.erase(retired);
+			}
+			else {
+				retired++;
+			}
 		}
-		// Notify the waiting threads that a write buffer is available
-		writeCondition.notify_one();
 	}
 
 	void LveMultipleVertexBuffer::exit() {
-		// Notify all the waiting threads that the program is exiting
+		// Wake up all the waiting threads since the program is exiting
 		// Use case: the rendering thread is waiting for a read buffer to be available
 		// but the frame generation thread has already exited => infinite wait
-		running = false;
-		readCondition.notify_all();
-		writeCondition.notify_all();
+		readBuffers.close();
+		writeBuffers.close();
+	}
+
+	void LveMultipleVertexBuffer::printStatistics() const {
+		const RingWaitStatistics& producer = producerWaitStatistics();
+		const RingWaitStatistics& consumer = consumerWaitStatistics();
+
+		printf("Generation waited %llu times (%llu sleeps) for %.3f s\n",
+			static_cast<unsigned long long>(producer.waits), static_cast<unsigned long long>(producer.parks), producer.waitSeconds);
+		printf("Rendering waited %llu times (%llu sleeps) for %.3f s\n",
+			static_cast<unsigned long long>(consumer.waits), static_cast<unsigned long long>(consumer.parks), consumer.waitSeconds);
+		if (mailbox) {
+			printf("Frames replaced before being shown: %llu\n", static_cast<unsigned long long>(droppedFrames()));
+		}
 	}
 }
\ No newline at end of file
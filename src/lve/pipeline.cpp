@@ -75,8 +75,8 @@ namespace lve {
 		shaderStages[1].pNext = nullptr;
 		shaderStages[1].pSpecializationInfo = nullptr;
 
-		auto bindingDescriptions = Vertex::getBindingDescriptions();
-		auto attributeDescriptions = Vertex::getAttributeDescriptions();
+		auto& bindingDescriptions = configInfo.bindingDescriptions;
+		auto& attributeDescriptions = configInfo.attributeDescriptions;
 
 		VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
 		vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
@@ -135,6 +135,9 @@ namespace lve {
 	PipelineConfigInfo LvePipeline::defaultPipelineConfigInfo(uint32_t width, uint32_t height) {
 		PipelineConfigInfo configInfo{};
 
+		configInfo.bindingDescriptions = Vertex::getBindingDescriptions();
+		configInfo.attributeDescriptions = Vertex::getAttributeDescriptions();
+
 		configInfo.inputAssemblyInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
 		configInfo.inputAssemblyInfo.topology = VK_PRIMITIVE_TOPOLOGY_POINT_LIST; // VK_PRIMITIVE_TOPOLOGY_POINT_LIST: points, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST: triangles
 		configInfo.inputAssemblyInfo.primitiveRestartEnable = VK_FALSE;
@@ -1,5 +1,7 @@
 #include "lve/swap_chain.hpp"
 
+#include "htc/trace.hpp"
+
 #include <array>
 #include <cstdlib>
 #include <cstring>
@@ -53,6 +55,8 @@ namespace lve {
   }
 
   VkResult LveSwapChain::acquireNextImage(uint32_t *imageIndex) {
+    TRACE_SCOPE("acquire image");
+
     vkWaitForFences(
         device.device(),
         1,
@@ -73,6 +77,8 @@ namespace lve {
 
   VkResult LveSwapChain::submitCommandBuffers(
       const VkCommandBuffer *buffers, uint32_t *imageIndex) {
+    TRACE_SCOPE("submit");
+
     if (imagesInFlight[*imageIndex] != VK_NULL_HANDLE) {
       vkWaitForFences(device.device(), 1, &imagesInFlight[*imageIndex], VK_TRUE, UINT64_MAX);
     }
@@ -1,39 +1,64 @@
 #include "lve/utils.hpp"
 
+#include <stdexcept>
 #include <stdio.h>
 
 
 namespace lve {
 
-	FPSCounter::FPSCounter(int printInterval) : fpsInterval{printInterval} {
-		// Set the lastFPSUpdate to the current time
-		lastFPSUpdate = std::chrono::high_resolution_clock::now();
+	LatencyReporter::LatencyReporter(int printInterval, std::vector<htc::LatencyHistogram*> histograms) : printInterval{printInterval}, histograms{histograms} {
+		if (printInterval < 0) {
+			throw std::invalid_argument("The latency interval cannot be negative");
+		}
+
+		// Set the lastPrint to the current time
+		lastPrint = std::chrono::steady_clock::now();
 	}
 
-	void FPSCounter::update() {
+	void LatencyReporter::update() {
 		// Increment the frame count
-		auto currentTime = std::chrono::high_resolution_clock::now();
+		auto currentTime = std::chrono::steady_clock::now();
 		frameCount++;
 
-		// Calculate the elapsed time since the last update
-		std::chrono::duration<float> elapsedTime = currentTime - lastFPSUpdate;
-		if (elapsedTime.count() >= fpsInterval) {
+		if (printInterval == 0) {
+			return;
+		}
+
+		// Calculate the elapsed time since the last print
+		std::chrono::duration<float> elapsedTime = currentTime - lastPrint;
+		if (elapsedTime.count() >= printInterval) {
 			float fps = frameCount / elapsedTime.count();
 			printf("FPS: %.2f\n", fps);
 
+			// The percentiles of the interval show the stalls that the average hides
+			for (htc::LatencyHistogram* histogram : histograms) {
+				htc::printLatencySummary(histogram->name(), histogram->intervalCounts().summarize());
+			}
+
 			// Reset the counters
 			frameCount = 0;
-			lastFPSUpdate = currentTime;
+			lastPrint = currentTime;
 		}
 	}
 
-	// Define the vertex format: Position [0] and Color [1]
+	void LatencyReporter::printTotals() const {
+		printf("Latencies since the start:\n");
+		for (const htc::LatencyHistogram* histogram : histograms) {
+			htc::printLatencySummary(histogram->name(), histogram->totalCounts().summarize());
+		}
+	}
+
+	// Define the vertex format: Position [0] and Color [1], each in its own binding
 	std::vector<VkVertexInputBindingDescription> Vertex::getBindingDescriptions() {
-		std::vector<VkVertexInputBindingDescription> bindingDescriptions(1);
+		std::vector<VkVertexInputBindingDescription> bindingDescriptions(2);
 		bindingDescriptions[0].binding = 0;
-		bindingDescriptions[0].stride = sizeof(Vertex);
+		bindingDescriptions[0].stride = sizeof(Position);
 		bindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
 
+		bindingDescriptions[1].binding = 1;
+		bindingDescriptions[1].stride = sizeof(Pixel);
+		bindingDescriptions[1].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
 		return bindingDescriptions;
 	}
 
@@ -42,12 +67,13 @@ namespace lve {
 		attributeDescriptions[0].binding = 0;
 		attributeDescriptions[0].location = 0;
 		attributeDescriptions[0].format = VK_FORMAT_R32G32_SFLOAT;
-		attributeDescriptions[0].offset = offsetof(Vertex, position);
+		attributeDescriptions[0].offset = 0;
 
-		attributeDescriptions[1].binding = 0;
+		// The 8-bit components are normalized to [0, 1] by the vertex input
+		attributeDescriptions[1].binding = 1;
 		attributeDescriptions[1].location = 1;
-		attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-		attributeDescriptions[1].offset = offsetof(Vertex, color);
+		attributeDescriptions[1].format = VK_FORMAT_R8G8B8A8_UNORM;
+		attributeDescriptions[1].offset = 0;
 
 		return attributeDescriptions;
 	}
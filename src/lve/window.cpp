@@ -19,6 +19,19 @@ namespace lve {
 		glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
 		glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
 		window = glfwCreateWindow(width, height, windowName.c_str(), nullptr, nullptr);
+
+		glfwSetWindowUserPointer(window, this);
+		glfwSetScrollCallback(window, scrollCallback);
+	}
+
+	void LveWindow::scrollCallback(GLFWwindow* window, double, double yOffset) {
+		static_cast<LveWindow*>(glfwGetWindowUserPointer(window))->scrollOffset += yOffset;
+	}
+
+	double LveWindow::takeScrollOffset() {
+		double offset = scrollOffset;
+		scrollOffset = 0.0;
+		return offset;
 	}
 
 	void LveWindow::createWindowSurface(VkInstance instance, VkSurfaceKHR* surface){
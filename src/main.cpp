@@ -1,13 +1,42 @@
 # include "render_engine.hpp"
+#include "htc/simulation_backend.hpp"
 
 #include <iostream>
 #include <cstdlib>
+#include <cstring>
 #include <stdexcept>
+#include <string>
 
 
-int main() {
-	lve::RenderEngine app{};
-	
+int main(int argc, char** argv) {
+	// Read the simulation options, the world has the size of the window unless --width or --height is given
+	htc::SimulationConfig simulationConfig{};
+
+	try {
+		for (int i = 1; i < argc; i++) {
+			if (htc::parseSimulationArgument(argc, argv, i, simulationConfig)) {
+				continue;
+			}
+
+			if (std::strcmp(argv[i], "--width") == 0 && i + 1 < argc) {
+				simulationConfig.width = std::stoi(argv[++i]);
+			}
+			else if (std::strcmp(argv[i], "--height") == 0 && i + 1 < argc) {
+				simulationConfig.height = std::stoi(argv[++i]);
+			}
+			else {
+				throw std::invalid_argument(std::string("Unknown argument: ") + argv[i]);
+			}
+		}
+	}
+	catch (const std::exception& e) {
+		std::cerr << e.what() << std::endl;
+		std::cerr << "Usage: " << argv[0] << " [--width W] [--height H] " << htc::simulationArgumentsUsage() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	lve::RenderEngine app{simulationConfig};
+
 	try {
 		app.run();
 	}
@@ -17,4 +46,4 @@ int main() {
 	}
 
 	return EXIT_SUCCESS;
-}
\ No newline at end of file
+}
@@ -2,56 +2,203 @@
 #include "lve/utils.hpp"
 
 #include "hip_tracer.hpp"
+#include "htc/display.hpp"
+#include "htc/trace.hpp"
 
 #include <stdexcept>
 #include <stdio.h>
+#include <algorithm>
 #include <array>
 #include <cmath>
 
 
 namespace lve {
 
-	RenderEngine::RenderEngine() {
-		createVertexSupplier();
+	RenderEngine::RenderEngine(htc::SimulationConfig simulationConfig) : display(simulationConfig.display),
+		latencyReportPath(simulationConfig.latencyReportPath), tracePath(simulationConfig.tracePath) {
+		// Enabled before the first step, so that the whole run is traced
+		if (!tracePath.empty()) {
+			htc::setTracingEnabled(true);
+			htc::setTraceThreadName("render");
+		}
+
+		createVertexSupplier(simulationConfig);
+		createDescriptorSets();
 		createPipelineLayout();
 		createPipeline();
 		createCommandBuffers();
+
+		latencyReporter = std::make_unique<LatencyReporter>(simulationConfig.latencyInterval,
+			std::vector<htc::LatencyHistogram*>{&stepLatency, &lveMultipleVertexBuffer->handoffLatency(), &presentLatency});
+
 		startUpdateThread();
 	}
 
 	RenderEngine::~RenderEngine() {
 		vkDestroyPipelineLayout(lveDevice.device(), pipelineLayout, nullptr);
+
+		// The descriptor sets are freed with their pool
+		if (descriptorPool != VK_NULL_HANDLE) {
+			vkDestroyDescriptorPool(lveDevice.device(), descriptorPool, nullptr);
+		}
+		if (descriptorSetLayout != VK_NULL_HANDLE) {
+			vkDestroyDescriptorSetLayout(lveDevice.device(), descriptorSetLayout, nullptr);
+		}
 	}
 
 	void RenderEngine::run() {
 		while (!lveWindow.shouldClose()) {
 			glfwPollEvents();
+			updateDisplayView();
 			drawFrame();
 
-			fpsCounter.update();
+			latencyReporter->update();
 		}
 
 		// Wait for all operations to finish before cleaning up
 		// If not done, we might remove resources that are still in use
 		stopUpdateThread();
-		lveMultipleVertexBuffer->exit();
 		vkDeviceWaitIdle(lveDevice.device());
+
+		lveMultipleVertexBuffer->printStatistics();
+		latencyReporter->printTotals();
+
+		if (!latencyReportPath.empty()) {
+			htc::writeLatencyReport(latencyReportPath, {&stepLatency, &lveMultipleVertexBuffer->handoffLatency(), &presentLatency});
+			printf("Latencies written to %s\n", latencyReportPath.c_str());
+		}
+
+		if (!tracePath.empty()) {
+			htc::setTracingEnabled(false);
+			htc::writeTrace(tracePath);
+			printf("Trace written to %s\n", tracePath.c_str());
+		}
 	}
 
-	void RenderEngine::createVertexSupplier() {
+	void RenderEngine::createVertexSupplier(htc::SimulationConfig simulationConfig) {
+		// Without a size, the simulation has one cell per pixel of the window
+		if (simulationConfig.width == 0) {
+			simulationConfig.width = WIDTH;
+		}
+		if (simulationConfig.height == 0) {
+			simulationConfig.height = HEIGHT;
+		}
+		if (simulationConfig.width < 1 || simulationConfig.height < 1) {
+			throw std::invalid_argument("The world needs at least one cell along each axis");
+		}
+
+		// The frames always have the size of the window, the whole world is shown first
+		displayView.width = WIDTH;
+		displayView.height = HEIGHT;
+		displayView.filter = simulationConfig.downsample;
+		maxZoom = std::max(1.0f, DISPLAY_MAX_CELL_PIXELS * std::max(static_cast<float>(simulationConfig.width) / WIDTH,
+																	static_cast<float>(simulationConfig.height) / HEIGHT));
+
 		// Create the vertex supplier and the multiple vertex buffer
-		uint32_t vertexBuffersCount = lveSwapChain.imageCount();
-		vertexSupplier = std::make_unique<htc::HipTracer>(WIDTH, HEIGHT, vertexBuffersCount, lveDevice);
-		lveMultipleVertexBuffer = std::make_unique<LveMultipleVertexBuffer>(lveDevice, vertexSupplier->bind(), vertexBuffersCount, WIDTH * HEIGHT);
+		// NOTE: One buffer is written, one waits to be shown, one is shown and the others are retired while the frames in flight read them
+		vertexBuffersCount = LveSwapChain::MAX_FRAMES_IN_FLIGHT + 3;
+		vertexSupplier = std::make_unique<htc::HipTracer>(simulationConfig, displayView, vertexBuffersCount, lveDevice);
+
+		printf("Scroll to zoom, drag to move the view, R to show the whole world\n");
+
+		// One point per pixel of the frame in the points display mode, the texture display mode does not use any position
+		std::vector<Position> positions;
+		if (display == htc::DisplayMode::Points) {
+			positions.reserve(WIDTH * HEIGHT);
+			for (int y = 0; y < HEIGHT; y++) {
+				for (int x = 0; x < WIDTH; x++) {
+					positions.push_back({2.0f * x / WIDTH - 1.0f, 2.0f * y / HEIGHT - 1.0f});
+				}
+			}
+		}
+		lveMultipleVertexBuffer = std::make_unique<LveMultipleVertexBuffer>(lveDevice, vertexSupplier->bind(), vertexBuffersCount, positions,
+																				simulationConfig.schedule == htc::FrameSchedule::Mailbox);
+	}
+
+	void RenderEngine::createDescriptorSets() {
+		if (display != htc::DisplayMode::Texture) {
+			return;
+		}
+
+		// The fragment shader reads the cells of one frame buffer
+		VkDescriptorSetLayoutBinding frameBinding{};
+		frameBinding.binding = 0;
+		frameBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		frameBinding.descriptorCount = 1;
+		frameBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+		VkDescriptorSetLayoutCreateInfo layoutInfo{};
+		layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		layoutInfo.bindingCount = 1;
+		layoutInfo.pBindings = &frameBinding;
+
+		if (vkCreateDescriptorSetLayout(lveDevice.device(), &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create descriptor set layout!");
+		}
+
+		std::vector<VkBuffer> frameBuffers = vertexSupplier->bind();
+		uint32_t setCount = static_cast<uint32_t>(frameBuffers.size());
+
+		VkDescriptorPoolSize poolSize{};
+		poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		poolSize.descriptorCount = setCount;
+
+		VkDescriptorPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		poolInfo.poolSizeCount = 1;
+		poolInfo.pPoolSizes = &poolSize;
+		poolInfo.maxSets = setCount;
+
+		if (vkCreateDescriptorPool(lveDevice.device(), &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create descriptor pool!");
+		}
+
+		// One set per frame buffer, they never change afterwards
+		std::vector<VkDescriptorSetLayout> layouts(setCount, descriptorSetLayout);
+		VkDescriptorSetAllocateInfo allocateInfo{};
+		allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocateInfo.descriptorPool = descriptorPool;
+		allocateInfo.descriptorSetCount = setCount;
+		allocateInfo.pSetLayouts = layouts.data();
+
+		descriptorSets.resize(setCount);
+		if (vkAllocateDescriptorSets(lveDevice.device(), &allocateInfo, descriptorSets.data()) != VK_SUCCESS) {
+			throw std::runtime_error("failed to allocate descriptor sets!");
+		}
+
+		for (uint32_t i = 0; i < setCount; i++) {
+			VkDescriptorBufferInfo bufferInfo{};
+			bufferInfo.buffer = frameBuffers[i];
+			bufferInfo.offset = 0;
+			bufferInfo.range = VK_WHOLE_SIZE;
+
+			VkWriteDescriptorSet write{};
+			write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			write.dstSet = descriptorSets[i];
+			write.dstBinding = 0;
+			write.descriptorCount = 1;
+			write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			write.pBufferInfo = &bufferInfo;
+
+			vkUpdateDescriptorSets(lveDevice.device(), 1, &write, 0, nullptr);
+		}
 	}
 
 	void RenderEngine::createPipelineLayout() {
+		VkPushConstantRange pushConstantRange{};
+		pushConstantRange.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+		pushConstantRange.offset = 0;
+		pushConstantRange.size = sizeof(DisplayPushConstants);
+
+		// The points display mode has no resources besides its vertex buffers
+		bool texture = display == htc::DisplayMode::Texture;
+
 		VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
 		pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-		pipelineLayoutInfo.setLayoutCount = 0;
-		pipelineLayoutInfo.pSetLayouts = nullptr;
-		pipelineLayoutInfo.pushConstantRangeCount = 0;
-		pipelineLayoutInfo.pPushConstantRanges = nullptr;
+		pipelineLayoutInfo.setLayoutCount = texture ? 1 : 0;
+		pipelineLayoutInfo.pSetLayouts = texture ? &descriptorSetLayout : nullptr;
+		pipelineLayoutInfo.pushConstantRangeCount = texture ? 1 : 0;
+		pipelineLayoutInfo.pPushConstantRanges = texture ? &pushConstantRange : nullptr;
 
 		if (vkCreatePipelineLayout(lveDevice.device(), &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
 			throw std::runtime_error("failed to create pipeline layout!");
@@ -63,6 +210,22 @@ namespace lve {
 		auto pipelineConfig = LvePipeline::defaultPipelineConfigInfo(lveSwapChain.width(), lveSwapChain.height());
 		pipelineConfig.renderPass = lveSwapChain.getRenderPass();
 		pipelineConfig.pipelineLayout = pipelineLayout;
+
+		// A single triangle without any vertex buffer, its vertices are generated from their index
+		if (display == htc::DisplayMode::Texture) {
+			pipelineConfig.inputAssemblyInfo.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+			pipelineConfig.bindingDescriptions.clear();
+			pipelineConfig.attributeDescriptions.clear();
+
+			lvePipeline = std::make_unique<LvePipeline>(
+				lveDevice,
+				"../shaders/fullscreen.vert.spv",
+				"../shaders/texture.frag.spv",
+				pipelineConfig
+			);
+			return;
+		}
+
 		lvePipeline = std::make_unique<LvePipeline>(
 			lveDevice,
 			"../shaders/simple_shader.vert.spv",
@@ -72,9 +235,9 @@ namespace lve {
 	}
 
 	void RenderEngine::createCommandBuffers() {
-		// Resize command buffers to hold one for each swap chain image
+		// Resize command buffers to hold one for each pair of swap chain image and vertex buffer
 		// Then bind them to the rendering pipeline and the vertex buffer
-		commandBuffers.resize(lveSwapChain.imageCount());
+		commandBuffers.resize(lveSwapChain.imageCount() * vertexBuffersCount);
 		VkCommandBufferAllocateInfo allocateInfo{};
 		allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
 		allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
@@ -86,6 +249,9 @@ namespace lve {
 		}
 
 		for (int i = 0; i < static_cast<int>(commandBuffers.size()); i++) {
+			int imageIndex = i / static_cast<int>(vertexBuffersCount);
+			int bufferIndex = i % static_cast<int>(vertexBuffersCount);
+
 			VkCommandBufferBeginInfo beginInfo{};
 			beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
 			
@@ -96,7 +262,7 @@ namespace lve {
 			VkRenderPassBeginInfo renderPassInfo{};
 			renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
 			renderPassInfo.renderPass = lveSwapChain.getRenderPass();
-			renderPassInfo.framebuffer = lveSwapChain.getFrameBuffer(i);
+			renderPassInfo.framebuffer = lveSwapChain.getFrameBuffer(imageIndex);
 
 			renderPassInfo.renderArea.offset = {0, 0};
 			renderPassInfo.renderArea.extent = lveSwapChain.getSwapChainExtent();
@@ -111,8 +277,19 @@ namespace lve {
 			vkCmdBeginRenderPass(commandBuffers[i], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
 
 			lvePipeline->bind(commandBuffers[i]);
-			lveMultipleVertexBuffer->bind(commandBuffers[i], i);
-			lveMultipleVertexBuffer->draw(commandBuffers[i]);
+
+			if (display == htc::DisplayMode::Texture) {
+				DisplayPushConstants pushConstants{WIDTH, HEIGHT,
+					static_cast<float>(lveSwapChain.width()), static_cast<float>(lveSwapChain.height())};
+
+				vkCmdBindDescriptorSets(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSets[bufferIndex], 0, nullptr);
+				vkCmdPushConstants(commandBuffers[i], pipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(pushConstants), &pushConstants);
+				vkCmdDraw(commandBuffers[i], 3, 1, 0, 0);
+			}
+			else {
+				lveMultipleVertexBuffer->bind(commandBuffers[i], bufferIndex);
+				lveMultipleVertexBuffer->draw(commandBuffers[i]);
+			}
 
 			vkCmdEndRenderPass(commandBuffers[i]);
 			if (vkEndCommandBuffer(commandBuffers[i]) != VK_SUCCESS) {
@@ -123,14 +300,76 @@ namespace lve {
 
 	void RenderEngine::updateVertexData() {
 		// Get the next available write buffer and update it
-		uint32_t writeBufferIndex = lveMultipleVertexBuffer->getAvailableWriteBuffer();
-		vertexSupplier->getNextFrame(writeBufferIndex);
+		uint32_t writeBufferIndex;
+		{
+			TRACE_SCOPE("wait write buffer");
+			if (!lveMultipleVertexBuffer->getAvailableWriteBuffer(writeBufferIndex)) {
+				return;
+			}
+		}
+		{
+			TRACE_SCOPE("simulation frame");
+			int64_t start = htc::traceClock();
+			vertexSupplier->getNextFrame(writeBufferIndex);
+			stepLatency.record(htc::traceClock() - start);
+		}
 		lveMultipleVertexBuffer->setReadBufferAvailable(writeBufferIndex);
 	}
 
+	void RenderEngine::updateDisplayView() {
+		GLFWwindow* window = lveWindow.getGLFWwindow();
+		htc::DisplayView view = displayView;
+
+		double cursorX;
+		double cursorY;
+		glfwGetCursorPos(window, &cursorX, &cursorY);
+
+		// The wheel zooms around the cell under the cursor, it stays under the cursor
+		double scroll = lveWindow.takeScrollOffset();
+		if (scroll != 0.0) {
+			float zoom = std::clamp(view.zoom * std::pow(DISPLAY_ZOOM_STEP, static_cast<float>(scroll)), 1.0f, maxZoom);
+			float offsetX = static_cast<float>(cursorX) / WIDTH - 0.5f;
+			float offsetY = static_cast<float>(cursorY) / HEIGHT - 0.5f;
+
+			view.centerX += offsetX / view.zoom - offsetX / zoom;
+			view.centerY += offsetY / view.zoom - offsetY / zoom;
+			view.zoom = zoom;
+		}
+
+		// Dragging with the left button moves the world with the cursor
+		bool pressed = glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS;
+		if (pressed && dragging) {
+			view.centerX -= static_cast<float>(cursorX - dragX) / WIDTH / view.zoom;
+			view.centerY -= static_cast<float>(cursorY - dragY) / HEIGHT / view.zoom;
+		}
+		dragging = pressed;
+		dragX = cursorX;
+		dragY = cursorY;
+
+		if (glfwGetKey(window, GLFW_KEY_R) == GLFW_PRESS) {
+			view.centerX = 0.5f;
+			view.centerY = 0.5f;
+			view.zoom = 1.0f;
+		}
+
+		htc::clampDisplayView(view);
+
+		// Only a moved view is handed to the simulation thread
+		if (view.centerX != displayView.centerX || view.centerY != displayView.centerY || view.zoom != displayView.zoom) {
+			displayView = view;
+			vertexSupplier->setDisplayView(displayView);
+		}
+	}
+
 	void RenderEngine::drawFrame() {
 		// Get the next available read buffer and submit it to the rendering pipeline
-		uint32_t readBufferIndex = lveMultipleVertexBuffer->getAvailableReadBuffer();
+		uint32_t readBufferIndex;
+		{
+			TRACE_SCOPE("wait read buffer");
+			if (!lveMultipleVertexBuffer->getAvailableReadBuffer(readBufferIndex)) {
+				return;
+			}
+		}
 		uint32_t imageIndex;
 
 		auto result = lveSwapChain.acquireNextImage(&imageIndex);
@@ -138,17 +377,28 @@ namespace lve {
 			throw std::runtime_error("failed to acquire next image!");
 		}
 
-		result = lveSwapChain.submitCommandBuffers(&commandBuffers[imageIndex], &imageIndex);
+		// Acquiring the image waited for the oldest frame in flight, the buffers only read by older frames can be written again
+		lveMultipleVertexBuffer->releaseCompletedBuffers(LveSwapChain::MAX_FRAMES_IN_FLIGHT);
+
+		// Draw the read buffer, not the buffer that shares the index of the image
+		result = lveSwapChain.submitCommandBuffers(&commandBuffers[imageIndex * vertexBuffersCount + readBufferIndex], &imageIndex);
 		if (result != VK_SUCCESS) {
 			throw std::runtime_error("failed to submit command buffer!");
 		}
 
-		lveMultipleVertexBuffer->setWriteBufferAvailable(readBufferIndex);
+		// Time between two presented frames, a stall of any stage shows up here
+		int64_t now = htc::traceClock();
+		if (lastPresent >= 0) {
+			presentLatency.record(now - lastPresent);
+		}
+		lastPresent = now;
 	}
 
 	void RenderEngine::startUpdateThread() {
 		// This thread will update the vertex data in the GPU
 		updateThread = std::thread([this]() {
+			htc::setTraceThreadName("simulation");
+
 			while (running.load()) {
 				updateVertexData();
 			}
@@ -157,7 +407,9 @@ namespace lve {
 
 	void RenderEngine::stopUpdateThread() {
 		// Stop the thread and wait for it to finish
+		// NOTE: The buffers are released first, the thread may be waiting for one that the render loop will never return
 		running.store(false);
+		lveMultipleVertexBuffer->exit();
 		if (updateThread.joinable()) {
 			updateThread.join();
 		}
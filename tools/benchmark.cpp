@@ -0,0 +1,356 @@
+#include "htc/simulation_backend.hpp"
+#include "htc/direct_kernels.hpp"
+
+#include "lve/pixel.hpp"
+
+#ifdef LENIA_ENABLE_HIP
+#include <hip/hip_runtime.h>
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef LENIA_GIT_REVISION
+#define LENIA_GIT_REVISION "unknown"
+#endif
+
+
+// Timing of a single stage for one configuration
+struct StageResult {
+	std::string stage;
+	int size;
+	int channels;
+	int kernelRadius;
+	int batchSize;
+	htc::ConvolutionMode convolution;
+	int iterations;
+	double seconds;
+	double bytes;		// Bytes moved per iteration, from a simple traffic model
+};
+
+static std::vector<int> parseIntList(const std::string& list) {
+	std::vector<int> values;
+	std::stringstream stream{list};
+	std::string item;
+	while (std::getline(stream, item, ',')) {
+		values.push_back(std::stoi(item));
+	}
+	if (values.empty()) {
+		throw std::invalid_argument("Empty list: " + list);
+	}
+	return values;
+}
+
+static std::vector<htc::ConvolutionMode> parseModeList(const std::string& list) {
+	std::vector<htc::ConvolutionMode> modes;
+	std::stringstream stream{list};
+	std::string item;
+	while (std::getline(stream, item, ',')) {
+		modes.push_back(htc::parseConvolutionMode(item));
+	}
+	if (modes.empty()) {
+		throw std::invalid_argument("Empty list: " + list);
+	}
+	return modes;
+}
+
+// Run the stage once to warm up, then until both the minimum time and iteration count are reached
+static void timeStage(const std::function<void()>& stage, double minTime, int minIterations, int& iterations, double& seconds) {
+	stage();
+
+	iterations = 0;
+	auto start = std::chrono::steady_clock::now();
+	std::chrono::duration<double> elapsed{0.0};
+	while (iterations < minIterations || elapsed.count() < minTime) {
+		stage();
+		iterations++;
+		elapsed = std::chrono::steady_clock::now() - start;
+	}
+	seconds = elapsed.count();
+}
+
+// Output buffer for the color stage, in the memory the backend writes to
+class OutputBuffer {
+
+	public:
+
+		OutputBuffer(size_t count, bool deviceMemory) : deviceMemory(deviceMemory) {
+			if (deviceMemory) {
+#ifdef LENIA_ENABLE_HIP
+				if (hipMalloc(&data, count * sizeof(lve::Pixel)) != hipSuccess) {
+					throw std::runtime_error("failed to allocate the output buffer");
+				}
+#else
+				throw std::runtime_error("device memory requested without HIP support");
+#endif
+			}
+			else {
+				hostData.resize(count);
+				data = hostData.data();
+			}
+		}
+
+		~OutputBuffer() {
+#ifdef LENIA_ENABLE_HIP
+			if (deviceMemory) {
+				(void)hipFree(data);
+			}
+#endif
+		}
+
+		OutputBuffer(const OutputBuffer&) = delete;
+		OutputBuffer& operator=(const OutputBuffer&) = delete;
+
+		lve::Pixel* get() { return data; }
+
+	private:
+
+		bool deviceMemory;
+		lve::Pixel* data = nullptr;
+		std::vector<lve::Pixel> hostData;
+};
+
+static void writeJson(const std::string& path, const std::string& backend, int threads, htc::Precision precision, const std::vector<StageResult>& results) {
+	std::ofstream file{path};
+	if (!file.is_open()) {
+		throw std::runtime_error("failed to open file: " + path);
+	}
+
+	file << "{\n";
+	file << "  \"backend\": \"" << backend << "\",\n";
+	file << "  \"threads\": " << threads << ",\n";
+	file << "  \"precision\": \"" << htc::precisionName(precision) << "\",\n";
+	file << "  \"revision\": \"" << LENIA_GIT_REVISION << "\",\n";
+	file << "  \"results\": [\n";
+	for (size_t i = 0; i < results.size(); i++) {
+		const StageResult& result = results[i];
+		double cells = static_cast<double>(result.size) * result.size * result.batchSize;
+		double perIteration = result.seconds / result.iterations;
+
+		file << "    {\"stage\": \"" << result.stage << "\""
+			<< ", \"size\": " << result.size
+			<< ", \"channels\": " << result.channels
+			<< ", \"kernel_radius\": " << result.kernelRadius
+			<< ", \"batch\": " << result.batchSize
+			<< ", \"convolution\": \"" << htc::convolutionModeName(result.convolution) << "\""
+			<< ", \"iterations\": " << result.iterations
+			<< ", \"seconds\": " << result.seconds
+			<< ", \"ns_per_cell\": " << perIteration * 1e9 / cells
+			<< ", \"gb_per_s\": " << result.bytes / perIteration * 1e-9 << "}"
+			<< (i + 1 < results.size() ? ",\n" : "\n");
+	}
+	file << "  ]\n";
+	file << "}\n";
+}
+
+// Padded planes and kernel tensor of a world, to time the direct row kernels alone on one thread
+// NOTE: Both kernels get the same inputs, the gap between them is the gain of the specialisation
+class DirectRowInputs {
+
+	public:
+
+		DirectRowInputs(int size, int channels, int radius) : size(size), channels(channels), radius(radius), paddedSize(size + 2 * radius) {
+			int kernelSize = 2 * radius + 1;
+			std::mt19937 generator{0};
+			std::uniform_real_distribution<float> values{0.0f, 1.0f};
+
+			kernel.resize(static_cast<size_t>(channels) * channels * kernelSize * kernelSize);
+			for (float& weight : kernel) {
+				weight = values(generator) / (kernelSize * kernelSize);
+			}
+			padded.resize(static_cast<size_t>(channels) * paddedSize * paddedSize);
+			for (float& value : padded) {
+				value = values(generator);
+			}
+			output.resize(static_cast<size_t>(size) * size);
+		}
+
+		void convolve(htc::DirectRowKernel rowKernel) {
+			for (int target = 0; target < channels; target++) {
+				for (int y = 0; y < size; y++) {
+					rowKernel(kernel.data(), padded.data(), paddedSize, paddedSize, size, channels, radius, target, y, &output[static_cast<size_t>(y) * size]);
+				}
+			}
+		}
+
+	private:
+
+		int size;
+		int channels;
+		int radius;
+		int paddedSize;
+
+		std::vector<float> kernel;
+		std::vector<float> padded;
+		std::vector<float> output;
+};
+
+static void printUsage(const char* program) {
+	std::cerr << "Usage: " << program << " [--sizes 256,512,...] [--channel-counts 1,3] [--radii 7,15,31] "
+		<< "[--modes direct,fft,separable] [--min-time SECONDS] [--min-iterations N] [--output results.json] "
+		<< htc::simulationArgumentsUsage() << std::endl;
+}
+
+
+// Time each stage of the simulation separately over a sweep of world sizes, channels, radii and convolution modes
+int main(int argc, char** argv) {
+	htc::SimulationConfig baseConfig{};
+
+	std::vector<int> sizes = {256, 512, 1024, 2048, 4096, 8192};
+	std::vector<int> channelCounts = {1, 3};
+	std::vector<int> radii = {7, 15, 31};
+	std::vector<htc::ConvolutionMode> modes = {htc::ConvolutionMode::Direct, htc::ConvolutionMode::Fft, htc::ConvolutionMode::Separable};
+	double minTime = 0.5;
+	int minIterations = 3;
+	std::string outputPath;
+
+	try {
+		for (int i = 1; i < argc; i++) {
+			if (htc::parseSimulationArgument(argc, argv, i, baseConfig)) {
+				continue;
+			}
+
+			if (std::strcmp(argv[i], "--sizes") == 0 && i + 1 < argc) {
+				sizes = parseIntList(argv[++i]);
+			}
+			else if (std::strcmp(argv[i], "--channel-counts") == 0 && i + 1 < argc) {
+				channelCounts = parseIntList(argv[++i]);
+			}
+			else if (std::strcmp(argv[i], "--radii") == 0 && i + 1 < argc) {
+				radii = parseIntList(argv[++i]);
+			}
+			else if (std::strcmp(argv[i], "--modes") == 0 && i + 1 < argc) {
+				modes = parseModeList(argv[++i]);
+			}
+			else if (std::strcmp(argv[i], "--min-time") == 0 && i + 1 < argc) {
+				minTime = std::stod(argv[++i]);
+			}
+			else if (std::strcmp(argv[i], "--min-iterations") == 0 && i + 1 < argc) {
+				minIterations = std::stoi(argv[++i]);
+			}
+			else if (std::strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+				outputPath = argv[++i];
+			}
+			else {
+				throw std::invalid_argument(std::string("Unknown argument: ") + argv[i]);
+			}
+		}
+	}
+	catch (const std::exception& e) {
+		std::cerr << e.what() << std::endl;
+		printUsage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	std::vector<StageResult> results;
+	std::string backendName = "none";
+
+	printf("%-12s %6s %3s %3s %-7s %10s %12s %10s\n", "stage", "size", "C", "R", "mode", "iters", "ns/cell", "GB/s");
+
+	try {
+		for (htc::ConvolutionMode mode : modes) {
+			for (int radius : radii) {
+				for (int channels : channelCounts) {
+					for (int size : sizes) {
+						htc::SimulationConfig config = baseConfig;
+						config.width = size;
+						config.height = size;
+						config.channels = channels;
+						config.kernelRadius = radius;
+						config.convolution = mode;
+
+						std::unique_ptr<htc::SimulationBackend> simulation = htc::createSimulationBackend(config);
+						backendName = simulation->name();
+
+						// The CPU backends round fp32 buffers, their 16-bit timings would only add the rounding pass
+						if (!simulation->usesDeviceMemory() && config.precision != htc::Precision::Float32) {
+							throw std::invalid_argument(std::string("The ") + backendName + " backend only emulates the 16-bit precisions, benchmark it in fp32");
+						}
+
+						// Only the first world of a batch is colored
+						double worldCells = static_cast<double>(size) * size;
+						double cells = worldCells * config.batchSize;
+						OutputBuffer output{static_cast<size_t>(worldCells), simulation->usesDeviceMemory()};
+
+						// Traffic model: read and write every plane once, the update also reads the state
+						// and the color stage reads up to 3 planes and writes an RGBA8 color
+						// NOTE: The fused update+color stage saves the read of the color planes
+						double valueSize = static_cast<double>(htc::precisionSize(config.precision));
+						struct Stage {
+							const char* name;
+							std::function<void()> run;
+							double bytes;
+						};
+						std::vector<Stage> stages = {
+							{"convolution", [&]() { simulation->runConvolution(); }, 2.0 * channels * cells * valueSize},
+							{"update", [&]() { simulation->runUpdate(); }, 3.0 * channels * cells * valueSize},
+							{"color", [&]() { simulation->runColor(output.get()); },
+								(std::min(channels, 3) * valueSize + sizeof(lve::Pixel)) * worldCells},
+							{"update+color", [&]() { simulation->runUpdateColor(output.get()); },
+								3.0 * channels * valueSize * cells + sizeof(lve::Pixel) * worldCells},
+							{"step", [&]() { simulation->step(nullptr); }, 5.0 * channels * cells * valueSize},
+						};
+
+						// The shapes compiled with LENIA_KERNEL_SHAPES are also timed against the generic row kernel
+						std::unique_ptr<DirectRowInputs> rowInputs;
+						if (mode == htc::ConvolutionMode::Direct && htc::isSpecializedKernelShape(radius, channels)) {
+							rowInputs = std::make_unique<DirectRowInputs>(size, channels, radius);
+							htc::DirectRowKernel specialized = htc::selectDirectRowKernel(radius, channels);
+							double rowBytes = 2.0 * channels * cells * sizeof(float);
+
+							stages.push_back({"row-generic", [&]() {
+								for (int world = 0; world < config.batchSize; world++) {
+									rowInputs->convolve(&htc::convolveDirectRow);
+								}
+							}, rowBytes});
+							stages.push_back({"row-special", [&, specialized]() {
+								for (int world = 0; world < config.batchSize; world++) {
+									rowInputs->convolve(specialized);
+								}
+							}, rowBytes});
+						}
+
+						for (const Stage& stage : stages) {
+							StageResult result{stage.name, size, channels, radius, config.batchSize, mode, 0, 0.0, stage.bytes};
+							timeStage(stage.run, minTime, minIterations, result.iterations, result.seconds);
+
+							double perIteration = result.seconds / result.iterations;
+							printf("%-12s %6d %3d %3d %-7s %10d %12.3f %10.2f\n", stage.name, size, channels, radius,
+								htc::convolutionModeName(mode), result.iterations, perIteration * 1e9 / cells,
+								result.bytes / perIteration * 1e-9);
+							fflush(stdout);
+
+							results.push_back(result);
+						}
+					}
+				}
+			}
+		}
+
+		if (!outputPath.empty()) {
+			// A thread count of 0 means one thread per hardware thread
+			int threads = baseConfig.threadCount > 0 ? baseConfig.threadCount : static_cast<int>(std::thread::hardware_concurrency());
+			writeJson(outputPath, backendName, threads, baseConfig.precision, results);
+			std::cout << "Results written to " << outputPath << std::endl;
+		}
+	}
+	catch (const std::exception& e) {
+		std::cerr << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,83 @@
+#include "htc/frame_recorder.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+
+// Write an 8-bit RGB frame as a binary PPM image
+static void writeFramePpm(const std::string& path, const std::vector<uint8_t>& rgb, int width, int height) {
+	std::ofstream file{path, std::ios::binary};
+	if (!file.is_open()) {
+		throw std::runtime_error("failed to open file: " + path);
+	}
+
+	file << "P6\n" << width << " " << height << "\n255\n";
+	file.write(reinterpret_cast<const char*>(rgb.data()), rgb.size());
+}
+
+static void printUsage(const char* program) {
+	std::cerr << "Usage: " << program << " recording.lrec [--frame N] [--output frame.ppm]" << std::endl;
+	std::cerr << "Prints the content of the recording, and extracts one frame with --output" << std::endl;
+}
+
+
+// Inspect a recording of lenia or lenia_headless and extract its frames
+int main(int argc, char** argv) {
+	std::string recordingPath;
+	std::string outputPath;
+	uint64_t frameIndex = 0;
+
+	try {
+		for (int i = 1; i < argc; i++) {
+			if (std::strcmp(argv[i], "--frame") == 0 && i + 1 < argc) {
+				frameIndex = std::stoull(argv[++i]);
+			}
+			else if (std::strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+				outputPath = argv[++i];
+			}
+			else if (argv[i][0] != '-' && recordingPath.empty()) {
+				recordingPath = argv[i];
+			}
+			else {
+				throw std::invalid_argument(std::string("Unknown argument: ") + argv[i]);
+			}
+		}
+
+		if (recordingPath.empty()) {
+			throw std::invalid_argument("No recording given");
+		}
+	}
+	catch (const std::exception& e) {
+		std::cerr << e.what() << std::endl;
+		printUsage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	try {
+		htc::FrameReader reader{recordingPath};
+		const htc::RecordingHeader& header = reader.header();
+
+		printf("%s: %llu frames of %ux%u, a keyframe every %u frames\n", recordingPath.c_str(),
+			static_cast<unsigned long long>(header.frameCount), header.width, header.height, header.keyframeInterval);
+
+		if (!outputPath.empty()) {
+			std::vector<uint8_t> rgb(static_cast<size_t>(header.width) * header.height * 3);
+			reader.readFrame(frameIndex, rgb.data());
+			writeFramePpm(outputPath, rgb, header.width, header.height);
+			std::cout << "Frame " << frameIndex << " written to " << outputPath << std::endl;
+		}
+	}
+	catch (const std::exception& e) {
+		std::cerr << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
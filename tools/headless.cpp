@@ -0,0 +1,254 @@
+#include "htc/simulation_backend.hpp"
+#include "htc/checkpoint.hpp"
+#include "htc/snapshot_writer.hpp"
+#include "htc/frame_recorder.hpp"
+#include "htc/latency_histogram.hpp"
+#include "htc/trace.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+
+// Write the state as a NumPy array of shape (worlds, channels, height, width), streamed one world at a time
+static void writeStateNpy(const std::string& path, htc::SimulationBackend& simulation) {
+	int worlds = simulation.batchSize();
+	int channels = simulation.channels();
+	int height = simulation.worldHeight();
+	int width = simulation.worldWidth();
+
+	std::ofstream file{path, std::ios::binary};
+	if (!file.is_open()) {
+		throw std::runtime_error("failed to open file: " + path);
+	}
+
+	std::string header = "{'descr': '<f4', 'fortran_order': False, 'shape': (" + std::to_string(worlds) + ", "
+		+ std::to_string(channels) + ", " + std::to_string(height) + ", " + std::to_string(width) + "), }";
+
+	// The header is padded with spaces so that the data starts on a 64 bytes boundary
+	size_t preambleSize = 6 + 2 + 2;
+	size_t paddedSize = ((preambleSize + header.size() + 1 + 63) / 64) * 64;
+	header.append(paddedSize - preambleSize - header.size() - 1, ' ');
+	header.push_back('\n');
+
+	uint16_t headerSize = static_cast<uint16_t>(header.size());
+	file.write("\x93NUMPY\x01\x00", 8);
+	file.write(reinterpret_cast<const char*>(&headerSize), sizeof(headerSize));
+	file.write(header.data(), header.size());
+	for (int world = 0; world < worlds; world++) {
+		simulation.streamWorldState(world, [&](const float* values, size_t count) {
+			file.write(reinterpret_cast<const char*>(values), count * sizeof(float));
+		});
+	}
+}
+
+static void printUsage(const char* program) {
+	std::cerr << "Usage: " << program << " [--width W] [--height H] [--steps N] [--output state.npy] [--metrics] "
+		<< "[--restore checkpoint.lenia] [--checkpoint checkpoint.lenia] "
+		<< htc::simulationArgumentsUsage() << std::endl;
+}
+
+
+// Run the simulation without any window or swap chain, as fast as possible
+int main(int argc, char** argv) {
+	htc::SimulationConfig config{};
+	config.width = 512;
+	config.height = 512;
+
+	int steps = 1000;
+	std::string outputPath;
+	std::string restorePath;
+	std::string checkpointPath;
+	bool printMetrics = false;
+
+	try {
+		for (int i = 1; i < argc; i++) {
+			if (htc::parseSimulationArgument(argc, argv, i, config)) {
+				continue;
+			}
+
+			if (std::strcmp(argv[i], "--width") == 0 && i + 1 < argc) {
+				config.width = std::stoi(argv[++i]);
+			}
+			else if (std::strcmp(argv[i], "--height") == 0 && i + 1 < argc) {
+				config.height = std::stoi(argv[++i]);
+			}
+			else if (std::strcmp(argv[i], "--steps") == 0 && i + 1 < argc) {
+				steps = std::stoi(argv[++i]);
+			}
+			else if (std::strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+				outputPath = argv[++i];
+			}
+			else if (std::strcmp(argv[i], "--metrics") == 0) {
+				printMetrics = true;
+			}
+			else if (std::strcmp(argv[i], "--restore") == 0 && i + 1 < argc) {
+				restorePath = argv[++i];
+			}
+			else if (std::strcmp(argv[i], "--checkpoint") == 0 && i + 1 < argc) {
+				checkpointPath = argv[++i];
+			}
+			else {
+				throw std::invalid_argument(std::string("Unknown argument: ") + argv[i]);
+			}
+		}
+	}
+	catch (const std::exception& e) {
+		std::cerr << e.what() << std::endl;
+		printUsage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	try {
+		// Enabled before the backend is created, so that the first steps are traced too
+		if (!config.tracePath.empty()) {
+			htc::setTracingEnabled(true);
+			htc::setTraceThreadName("main");
+		}
+
+		// A restored run takes the shape, the boundary and the precision of the checkpoint and continues its step count
+		std::unique_ptr<htc::SimulationBackend> simulation;
+		uint64_t firstStep = 0;
+
+		if (!restorePath.empty()) {
+			auto start = std::chrono::steady_clock::now();
+
+			htc::MappedCheckpoint checkpoint{restorePath};
+			config = htc::checkpointConfig(checkpoint, config);
+			simulation = htc::createSimulationBackend(config);
+			firstStep = htc::restoreCheckpoint(checkpoint, *simulation);
+
+			std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+			printf("Restored %s at step %llu in %.3f s\n", restorePath.c_str(), static_cast<unsigned long long>(firstStep), elapsed.count());
+		}
+		else {
+			// A random seed is resolved here so that it can be printed, --seed reproduces the run
+			config.seed = htc::initialSeed(config);
+			simulation = htc::createSimulationBackend(config);
+		}
+
+		std::cout << "Backend: " << simulation->name() << ", world: " << config.width << "x" << config.height
+			<< "x" << simulation->channels() << ", batch: " << simulation->batchSize()
+			<< ", kernel radius: " << config.kernelRadius;
+		if (restorePath.empty()) {
+			std::cout << ", seed: " << config.seed;
+		}
+		std::cout << std::endl;
+
+		// Snapshots are compressed and written in the background, the steps only pay for the copy
+		std::unique_ptr<htc::SnapshotWriter> snapshots;
+		if (config.snapshotInterval > 0) {
+			snapshots = std::make_unique<htc::SnapshotWriter>(config.snapshotDirectory, *simulation);
+		}
+
+		// The first world is recorded, colored like the viewer does
+		std::unique_ptr<htc::FrameRecorder> recorder;
+		std::vector<float> worldState;
+		std::vector<uint8_t> frame;
+		if (!config.recordPath.empty()) {
+			recorder = std::make_unique<htc::FrameRecorder>(config.recordPath, config.width, config.height);
+			worldState.resize(static_cast<size_t>(simulation->channels()) * config.width * config.height);
+			frame.resize(3 * static_cast<size_t>(config.width) * config.height);
+		}
+
+		// Step without any output, the step latencies show the stalls that the throughput averages out
+		htc::LatencyHistogram stepLatency{"step"};
+		double activeSum = 0.0;
+		double activeMin = 1.0;
+		auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i < steps; i++) {
+			int64_t stepStart = htc::traceClock();
+			simulation->step(nullptr);
+			stepLatency.record(htc::traceClock() - stepStart);
+
+			activeSum += simulation->activeFraction();
+			activeMin = std::min(activeMin, simulation->activeFraction());
+
+			if (recorder) {
+				simulation->readWorldState(0, worldState.data());
+				htc::quantizeState(worldState.data(), simulation->channels(), config.width, config.height, frame.data());
+				recorder->recordFrame(frame.data());
+			}
+
+			uint64_t step = firstStep + i + 1;
+			if (snapshots && step % config.snapshotInterval == 0) {
+				snapshots->capture(*simulation, step);
+			}
+		}
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+		double stepsPerSecond = steps / elapsed.count();
+		double cellsPerSecond = stepsPerSecond * config.width * config.height * simulation->batchSize();
+		printf("Steps: %d in %.3f s, %.2f steps/s, %.3e cells/s\n", steps, elapsed.count(), stepsPerSecond, cellsPerSecond);
+		htc::printLatencySummary(stepLatency.name(), stepLatency.totalCounts().summarize());
+
+		// Share of the tiles stepped, the others were quiescent (the other backends step everything)
+		if (config.activityEpsilon > 0.0f && steps > 0 && std::strcmp(simulation->name(), "tiled") == 0) {
+			printf("Active tiles: %.1f%% on average, %.1f%% at least, %.1f%% in the last step\n",
+				100.0 * activeSum / steps, 100.0 * activeMin, 100.0 * simulation->activeFraction());
+		}
+
+		if (!config.latencyReportPath.empty()) {
+			htc::writeLatencyReport(config.latencyReportPath, {&stepLatency});
+			std::cout << "Latencies written to " << config.latencyReportPath << std::endl;
+		}
+
+		// Mass of each channel of each world
+		if (printMetrics) {
+			std::vector<htc::WorldMetrics> metrics = simulation->readMetrics();
+			for (size_t world = 0; world < metrics.size(); world++) {
+				printf("World %zu: mass", world);
+				for (float mass : metrics[world].mass) {
+					printf(" %.3f", mass);
+				}
+				printf(", max");
+				for (float maximum : metrics[world].maximum) {
+					printf(" %.3f", maximum);
+				}
+				printf("\n");
+			}
+		}
+
+		if (snapshots) {
+			snapshots->flush();
+			snapshots->printStatistics();
+		}
+
+		if (recorder) {
+			recorder->flush();
+			recorder->printStatistics();
+		}
+
+		if (!config.tracePath.empty()) {
+			htc::setTracingEnabled(false);
+			htc::writeTrace(config.tracePath);
+			std::cout << "Trace written to " << config.tracePath << std::endl;
+		}
+
+		// Write the final state of all the worlds
+		if (!outputPath.empty()) {
+			writeStateNpy(outputPath, *simulation);
+			std::cout << "Final state written to " << outputPath << std::endl;
+		}
+
+		if (!checkpointPath.empty()) {
+			htc::saveCheckpoint(checkpointPath, *simulation, firstStep + steps);
+			std::cout << "Checkpoint at step " << firstStep + steps << " written to " << checkpointPath << std::endl;
+		}
+	}
+	catch (const std::exception& e) {
+		std::cerr << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
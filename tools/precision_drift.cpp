@@ -0,0 +1,148 @@
+#include "htc/simulation_backend.hpp"
+#include "htc/precision.hpp"
+#include "htc/regression.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+
+static void printUsage(const char* program) {
+	std::cerr << "Usage: " << program << " [--width W] [--height H] [--steps N] [--interval N] [--max-error E] "
+		<< htc::simulationArgumentsUsage() << std::endl;
+	std::cerr << "The simulation options describe the reduced precision run, the reference runs the same config in fp32" << std::endl;
+}
+
+
+// Values of the state that the storage format can't hold, the backend should have rounded them
+static size_t countUnrepresentable(htc::Precision precision, const std::vector<float>& state) {
+	std::vector<float> rounded = state;
+	htc::roundToPrecision(precision, rounded.data(), rounded.size());
+
+	size_t count = 0;
+	for (size_t i = 0; i < state.size(); i++) {
+		count += rounded[i] != state[i];
+	}
+	return count;
+}
+
+
+// Step an fp32 reference and a reduced precision simulation from the same seed, and report how far they drift apart
+int main(int argc, char** argv) {
+	htc::SimulationConfig config{};
+	config.width = 256;
+	config.height = 256;
+	config.precision = htc::Precision::Float16;
+
+	int steps = 1000;
+	int interval = 100;
+	double maxError = -1.0;
+
+	try {
+		for (int i = 1; i < argc; i++) {
+			if (htc::parseSimulationArgument(argc, argv, i, config)) {
+				continue;
+			}
+
+			if (std::strcmp(argv[i], "--width") == 0 && i + 1 < argc) {
+				config.width = std::stoi(argv[++i]);
+			}
+			else if (std::strcmp(argv[i], "--height") == 0 && i + 1 < argc) {
+				config.height = std::stoi(argv[++i]);
+			}
+			else if (std::strcmp(argv[i], "--steps") == 0 && i + 1 < argc) {
+				steps = std::stoi(argv[++i]);
+			}
+			else if (std::strcmp(argv[i], "--interval") == 0 && i + 1 < argc) {
+				interval = std::stoi(argv[++i]);
+			}
+			else if (std::strcmp(argv[i], "--max-error") == 0 && i + 1 < argc) {
+				maxError = std::stod(argv[++i]);
+			}
+			else {
+				throw std::invalid_argument(std::string("Unknown argument: ") + argv[i]);
+			}
+		}
+
+		if (interval < 1) {
+			throw std::invalid_argument("The interval must be at least 1");
+		}
+	}
+	catch (const std::exception& e) {
+		std::cerr << e.what() << std::endl;
+		printUsage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	try {
+		// Both runs must start from the same state
+		config.seed = htc::initialSeed(config);
+
+		htc::SimulationConfig referenceConfig = config;
+		referenceConfig.precision = htc::Precision::Float32;
+
+		std::unique_ptr<htc::SimulationBackend> reference = htc::createSimulationBackend(referenceConfig);
+		std::unique_ptr<htc::SimulationBackend> simulation = htc::createSimulationBackend(config);
+
+		std::cout << "Backend: " << simulation->name() << ", world: " << config.width << "x" << config.height
+			<< "x" << simulation->channels() << ", batch: " << simulation->batchSize()
+			<< ", precision: " << htc::precisionName(config.precision) << " against fp32, seed: " << config.seed << std::endl;
+
+		size_t stateSize = static_cast<size_t>(simulation->batchSize()) * simulation->channels() * config.width * config.height;
+		std::vector<float> referenceState(stateSize);
+		std::vector<float> state(stateSize);
+
+		printf("%8s %12s %12s %12s\n", "step", "max error", "rms error", "mass drift");
+
+		htc::StateError worst;
+		size_t unrepresentable = 0;
+		for (int step = 1; step <= steps; step++) {
+			reference->step(nullptr);
+			simulation->step(nullptr);
+
+			if (step % interval != 0 && step != steps) {
+				continue;
+			}
+
+			reference->readState(referenceState.data());
+			simulation->readState(state.data());
+			unrepresentable = std::max(unrepresentable, countUnrepresentable(config.precision, state));
+
+			htc::StateError drift = htc::measureStateError(referenceState.data(), state.data(), stateSize);
+			printf("%8d %12.4e %12.4e %+12.4e\n", step, drift.maxError, drift.rmsError, drift.massDrift);
+
+			worst.maxError = std::max(worst.maxError, drift.maxError);
+			worst.rmsError = std::max(worst.rmsError, drift.rmsError);
+			if (std::abs(drift.massDrift) > std::abs(worst.massDrift)) {
+				worst.massDrift = drift.massDrift;
+			}
+		}
+
+		printf("Worst: max error %.4e, rms error %.4e, mass drift %+.4e\n", worst.maxError, worst.rmsError, worst.massDrift);
+
+		// A state that isn't stored in the reduced format makes the drift meaningless
+		if (unrepresentable > 0) {
+			printf("FAILED: %zu values of the state are not representable in %s\n", unrepresentable, htc::precisionName(config.precision));
+			return EXIT_FAILURE;
+		}
+
+		// Exit with an error past the threshold, so that the tool can gate a precision change
+		if (maxError >= 0.0 && worst.maxError > maxError) {
+			printf("FAILED: max error above %.4e\n", maxError);
+			return EXIT_FAILURE;
+		}
+	}
+	catch (const std::exception& e) {
+		std::cerr << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
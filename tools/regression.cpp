@@ -0,0 +1,247 @@
+#include "htc/simulation_backend.hpp"
+#include "htc/checkpoint.hpp"
+#include "htc/precision.hpp"
+#include "htc/regression.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+
+// Thresholds of a check, a negative one is not checked and NAN takes the default of the engine options
+struct Thresholds {
+	double maxError = NAN;
+	double maxRms = NAN;
+	double maxMassDrift = NAN;
+};
+
+static void printUsage(const char* program) {
+	std::cerr << "Usage: " << program << " (--save DIR | --check DIR) [--width W] [--height H] [--steps N] [--interval N] "
+		<< "[--max-error E] [--max-rms E] [--max-mass-drift E] " << htc::simulationArgumentsUsage() << std::endl;
+	std::cerr << "--save steps the config from its seed and stores a golden checkpoint every interval steps" << std::endl;
+	std::cerr << "--check replays the golden run with the engine options and compares each channel of each world" << std::endl;
+}
+
+static std::string describeEngine(const htc::SimulationBackend& simulation, const htc::SimulationConfig& config) {
+	return std::string(simulation.name()) + " " + htc::convolutionModeName(config.convolution) + " " + htc::precisionName(config.precision);
+}
+
+// Step the config from its seed and store the golden checkpoints, the first one holds the initial state
+static void saveGolden(const std::string& directory, htc::SimulationConfig config, int steps, int interval) {
+	config.seed = htc::initialSeed(config);
+	std::unique_ptr<htc::SimulationBackend> simulation = htc::createSimulationBackend(config);
+
+	std::filesystem::create_directories(directory);
+
+	htc::GoldenManifest manifest;
+	manifest.seed = config.seed;
+	manifest.reference = describeEngine(*simulation, config);
+
+	std::cout << "Saving " << manifest.reference << ", world: " << config.width << "x" << config.height
+		<< "x" << simulation->channels() << ", batch: " << simulation->batchSize() << ", seed: " << config.seed << std::endl;
+
+	for (int step = 0; step <= steps; step++) {
+		if (step > 0) {
+			simulation->step(nullptr);
+		}
+		if (step % interval != 0 && step != steps) {
+			continue;
+		}
+
+		htc::saveCheckpoint(htc::goldenSnapshotPath(directory, step), *simulation, step);
+		manifest.steps.push_back(step);
+	}
+
+	// Written last, an interrupted save is never taken for a complete one
+	htc::writeGoldenManifest(directory, manifest);
+	printf("Saved %zu golden states in %s\n", manifest.steps.size(), directory.c_str());
+}
+
+// Replay the golden run with the engine options of the config, returns false if a threshold is exceeded
+static bool checkGolden(const std::string& directory, htc::SimulationConfig config, Thresholds thresholds) {
+	htc::GoldenManifest manifest = htc::readGoldenManifest(directory);
+
+	// The golden run gives everything the states depend on, the config only chooses how they are computed
+	// NOTE: The boundary mode comes from the checkpoint, like the shape
+	htc::MappedCheckpoint first{htc::goldenSnapshotPath(directory, manifest.steps.front())};
+	// NOTE: The precision of the golden run is replaced by the one being checked
+	htc::Precision precision = config.precision;
+	config = htc::checkpointConfig(first, config);
+	config.seed = manifest.seed;
+	config.precision = precision;
+
+	std::unique_ptr<htc::SimulationBackend> simulation = htc::createSimulationBackend(config);
+
+	htc::StateError defaults = htc::goldenThresholds(config.convolution, config.precision);
+	if (std::isnan(thresholds.maxError)) {
+		thresholds.maxError = defaults.maxError;
+	}
+	if (std::isnan(thresholds.maxRms)) {
+		thresholds.maxRms = defaults.rmsError;
+	}
+	if (std::isnan(thresholds.maxMassDrift)) {
+		thresholds.maxMassDrift = defaults.massDrift;
+	}
+
+	// setParameters resets the growth of every world, so the per world ones come after it
+	simulation->setParameters(first.parameters());
+	for (int world = 0; world < simulation->batchSize(); world++) {
+		simulation->setWorldGrowth(world, first.worldGrowth(world));
+	}
+
+	std::cout << "Checking " << describeEngine(*simulation, config) << " against " << manifest.reference
+		<< ", world: " << config.width << "x" << config.height << "x" << simulation->channels()
+		<< ", batch: " << simulation->batchSize() << ", seed: " << config.seed << std::endl;
+
+	size_t planeSize = static_cast<size_t>(config.width) * config.height;
+	size_t worldSize = planeSize * simulation->channels();
+	std::vector<float> state(worldSize * simulation->batchSize());
+
+	printf("%8s %6s %8s %12s %12s %12s\n", "step", "world", "channel", "max error", "rms error", "mass drift");
+
+	htc::StateError worst;
+	uint64_t step = 0;
+	for (uint64_t goldenStep : manifest.steps) {
+		for (; step < goldenStep; step++) {
+			simulation->step(nullptr);
+		}
+
+		htc::MappedCheckpoint golden{htc::goldenSnapshotPath(directory, goldenStep)};
+		const htc::CheckpointHeader& header = golden.header();
+		if (header.step != goldenStep || header.width != first.header().width || header.height != first.header().height
+			|| header.channels != first.header().channels || header.batch != first.header().batch) {
+			throw std::runtime_error("The golden checkpoint of step " + std::to_string(goldenStep) + " doesn't match the manifest");
+		}
+
+		simulation->readState(state.data());
+
+		for (int world = 0; world < simulation->batchSize(); world++) {
+			const float* reference = golden.worldState(world);
+
+			for (int channel = 0; channel < simulation->channels(); channel++) {
+				size_t offset = channel * planeSize;
+				htc::StateError error = htc::measureStateError(reference + offset, &state[world * worldSize + offset], planeSize);
+				printf("%8llu %6d %8d %12.4e %12.4e %+12.4e\n", static_cast<unsigned long long>(goldenStep), world, channel,
+					error.maxError, error.rmsError, error.massDrift);
+
+				worst.maxError = std::max(worst.maxError, error.maxError);
+				worst.rmsError = std::max(worst.rmsError, error.rmsError);
+				if (std::abs(error.massDrift) > std::abs(worst.massDrift)) {
+					worst.massDrift = error.massDrift;
+				}
+			}
+		}
+	}
+
+	printf("Worst: max error %.4e, rms error %.4e, mass drift %+.4e\n", worst.maxError, worst.rmsError, worst.massDrift);
+
+	bool passed = true;
+	if (thresholds.maxError >= 0.0 && !(worst.maxError <= thresholds.maxError)) {
+		printf("FAILED: max error above %.4e\n", thresholds.maxError);
+		passed = false;
+	}
+	if (thresholds.maxRms >= 0.0 && !(worst.rmsError <= thresholds.maxRms)) {
+		printf("FAILED: rms error above %.4e\n", thresholds.maxRms);
+		passed = false;
+	}
+	if (thresholds.maxMassDrift >= 0.0 && !(std::abs(worst.massDrift) <= thresholds.maxMassDrift)) {
+		printf("FAILED: mass drift above %.4e\n", thresholds.maxMassDrift);
+		passed = false;
+	}
+	if (passed) {
+		printf("PASSED\n");
+	}
+	return passed;
+}
+
+
+// Record golden states of a reference run, or check an engine configuration against them
+// NOTE: Every backend starts from the same state for a given seed, so the CPU backends can record the states checked on the GPU
+int main(int argc, char** argv) {
+	htc::SimulationConfig config{};
+	config.width = 128;
+	config.height = 128;
+	config.seed = 1;
+	config.backend = htc::BackendType::Cpu;
+
+	std::string saveDirectory;
+	std::string checkDirectory;
+	int steps = GOLDEN_STEPS;
+	int interval = 50;
+	Thresholds thresholds;
+
+	try {
+		for (int i = 1; i < argc; i++) {
+			if (htc::parseSimulationArgument(argc, argv, i, config)) {
+				continue;
+			}
+
+			if (std::strcmp(argv[i], "--save") == 0 && i + 1 < argc) {
+				saveDirectory = argv[++i];
+			}
+			else if (std::strcmp(argv[i], "--check") == 0 && i + 1 < argc) {
+				checkDirectory = argv[++i];
+			}
+			else if (std::strcmp(argv[i], "--width") == 0 && i + 1 < argc) {
+				config.width = std::stoi(argv[++i]);
+			}
+			else if (std::strcmp(argv[i], "--height") == 0 && i + 1 < argc) {
+				config.height = std::stoi(argv[++i]);
+			}
+			else if (std::strcmp(argv[i], "--steps") == 0 && i + 1 < argc) {
+				steps = std::stoi(argv[++i]);
+			}
+			else if (std::strcmp(argv[i], "--interval") == 0 && i + 1 < argc) {
+				interval = std::stoi(argv[++i]);
+			}
+			else if (std::strcmp(argv[i], "--max-error") == 0 && i + 1 < argc) {
+				thresholds.maxError = std::stod(argv[++i]);
+			}
+			else if (std::strcmp(argv[i], "--max-rms") == 0 && i + 1 < argc) {
+				thresholds.maxRms = std::stod(argv[++i]);
+			}
+			else if (std::strcmp(argv[i], "--max-mass-drift") == 0 && i + 1 < argc) {
+				thresholds.maxMassDrift = std::stod(argv[++i]);
+			}
+			else {
+				throw std::invalid_argument(std::string("Unknown argument: ") + argv[i]);
+			}
+		}
+
+		if (saveDirectory.empty() == checkDirectory.empty()) {
+			throw std::invalid_argument("Exactly one of --save and --check is needed");
+		}
+		if (steps < 0 || interval < 1) {
+			throw std::invalid_argument("The steps can't be negative and the interval must be at least 1");
+		}
+	}
+	catch (const std::exception& e) {
+		std::cerr << e.what() << std::endl;
+		printUsage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	try {
+		if (!saveDirectory.empty()) {
+			saveGolden(saveDirectory, config, steps, interval);
+		}
+		else if (!checkGolden(checkDirectory, config, thresholds)) {
+			return EXIT_FAILURE;
+		}
+	}
+	catch (const std::exception& e) {
+		std::cerr << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}